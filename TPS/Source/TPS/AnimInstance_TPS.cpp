@@ -5,14 +5,32 @@
 #include "TPSCharacter.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "Kismet/KismetSystemLibrary.h"
+#include "PortalSubsystem.h"
 
+DECLARE_DWORD_COUNTER_STAT(TEXT("Foot IK Traces"), STAT_FootIKTraces, STATGROUP_Game);
+
+void FAnimInstanceProxy_TPS::Update(float DeltaSeconds)
+{
+	FAnimInstanceProxy::Update(DeltaSeconds);
+
+	if (UAnimInstance_TPS* AnimInstance = Cast<UAnimInstance_TPS>(GetAnimInstanceObject()))
+		AnimInstance->FootIK(DeltaSeconds, FootIKInput);
+}
 
 
 UAnimInstance_TPS::UAnimInstance_TPS()
 {
 	IKInterpSpeed = 20.f;
+	MaxFootIKLOD = 1;
+	LastTraceLocation = FVector::ZeroVector;
+	LastTraceYaw = 0.f;
+	bHasFootTraces = false;
+
+}
 
+FAnimInstanceProxy* UAnimInstance_TPS::CreateAnimInstanceProxy()
+{
+	return new FAnimInstanceProxy_TPS(this);
 }
 
 void UAnimInstance_TPS::NativeBeginPlay()
@@ -42,35 +60,44 @@ void UAnimInstance_TPS::NativeUpdateAnimation(float DeltaSeconds)
 		IsInAir = Character->GetCharacterMovement()->IsFalling();
 	}
 
-	FootIK(DeltaSeconds);
+	FootIKInput.bActive = IsFootIKRelevant();
+	if (FootIKInput.bActive)
+	{
+		ReadFootTraces();
+		RequestFootTraces();
+	}
+	else
+	{
+		// Whatever is in flight would be stale by the time IK is back
+		for (FTraceHandle& Handle : FootTraceHandles)
+			Handle = FTraceHandle();
+		bHasFootTraces = false;
+	}
+
+	GetProxyOnGameThread<FAnimInstanceProxy_TPS>().FootIKInput = FootIKInput;
 }
 
-void UAnimInstance_TPS::FootIK(float DeltaTime)
+void UAnimInstance_TPS::FootIK(float DeltaTime, const FFootIKInput& Input)
 {
-	if (Character && !IsInAir)
+	if (Input.bActive)
 	{
-		IgnoreActors.Emplace(Character);
-
-		TTuple<bool, float> Foot_R = CapsuleDistance("foot_r", Character);
-		TTuple<bool, float> Foot_L = CapsuleDistance("foot_l", Character);
+		const FFootTrace& Foot_R = Input.Feet[0];
+		const FFootTrace& Foot_L = Input.Feet[1];
 
-		if (Foot_L.Get<0>() || Foot_R.Get<0>())
+		if (Foot_L.bCapsuleHit || Foot_R.bCapsuleHit)
 		{
-			const float Selectfloat = UKismetMathLibrary::SelectFloat(Foot_L.Get<1>(), Foot_R.Get<1>(), Foot_L.Get<1>() >= Foot_R.Get<1>());
+			const float Selectfloat = UKismetMathLibrary::SelectFloat(Foot_L.CapsuleDistance, Foot_R.CapsuleDistance, Foot_L.CapsuleDistance >= Foot_R.CapsuleDistance);
 			Displacement = FMath::FInterpTo(Displacement, (Selectfloat - 100.f) * -1.f, DeltaTime, IKInterpSpeed);
 
-			TTuple<bool, float, FVector> FootTrace_R = FootLineTrace("foot_r", Character);
-			TTuple<bool, float, FVector> FootTrace_L = FootLineTrace("foot_l", Character);
-
-			const float Distance_R = FootTrace_R.Get<1>();
-			const FVector FootRVector(FootTrace_R.Get<2>());
+			const float Distance_R = Foot_R.FootDistance;
+			const FVector FootRVector(Foot_R.FootNormal);
 			const FRotator MakeRRot(UKismetMathLibrary::DegAtan2(FootRVector.X, FootRVector.Z) * -1.f, 0.f, UKismetMathLibrary::DegAtan2(FootRVector.Y, FootRVector.Z));
 
 			RRot = FMath::RInterpTo(RRot, MakeRRot, DeltaTime, IKInterpSpeed);
 			RIK = FMath::FInterpTo(RIK, (Distance_R - 110.f) / -45.f, DeltaTime, IKInterpSpeed);
 
-			const float Distance_L = FootTrace_L.Get<1>();
-			const FVector FootLVector(FootTrace_L.Get<2>());
+			const float Distance_L = Foot_L.FootDistance;
+			const FVector FootLVector(Foot_L.FootNormal);
 			const FRotator MakeLRot(UKismetMathLibrary::DegAtan2(FootLVector.X, FootLVector.Z) * -1.f, 0.f, UKismetMathLibrary::DegAtan2(FootLVector.Y, FootLVector.Z));
 
 			LRot = FMath::RInterpTo(LRot, MakeLRot, DeltaTime, IKInterpSpeed);
@@ -88,62 +115,113 @@ void UAnimInstance_TPS::FootIK(float DeltaTime)
 
 }
 
-TTuple<bool, float> UAnimInstance_TPS::CapsuleDistance(FName SocketName, ACharacter* Char)
+bool UAnimInstance_TPS::IsFootIKRelevant() const
 {
-	const FVector WorldLocation{ Char->GetMesh()->GetComponentLocation() };
-	const FVector BreakVector{ WorldLocation + FVector(0.f,0.f,98.f) };
+	USkeletalMeshComponent* Mesh = GetSkelMeshComponent();
+	if (Character == nullptr || Mesh == nullptr || IsInAir) return false;
 
-	const FVector SocketLocation{ Char->GetMesh()->GetSocketLocation(SocketName) };
-
-	const FVector Start{ SocketLocation.X,SocketLocation.Y,BreakVector.Z};
-	const FVector End{ Start - FVector(0.f,0.f,151.f) };
+	// Nobody sees the feet of a character off screen or far enough to drop LODs
+	return Mesh->WasRecentlyRendered(0.2f) && Mesh->GetPredictedLODLevel() <= MaxFootIKLOD;
+}
 
-	FHitResult HitResult;
+void UAnimInstance_TPS::ReadFootTraces()
+{
+	UWorld* World = GetWorld();
 
-	UKismetSystemLibrary::LineTraceSingle(
-		this,
-		Start,
-		End,
-		ETraceTypeQuery::TraceTypeQuery1,
-		false,
-		IgnoreActors,
-		EDrawDebugTrace::None,
-		HitResult,
-		false);
+	for (int32 i = 0; i < 4; ++i)
+	{
+		FTraceHandle& Handle = FootTraceHandles[i];
+		if (Handle.IsValid() == false) continue;
 
-	const bool Result(HitResult.bBlockingHit);
+		// Queued last frame, ready now
+		FTraceDatum Datum;
+		if (World->QueryTraceData(Handle, Datum) == false)
+		{
+			if (World->IsTraceHandleValid(Handle, false) == false)
+				Handle = FTraceHandle();
+			continue;
+		}
+		Handle = FTraceHandle();
 
-	return MakeTuple(Result, HitResult.Distance);
+		const FHitResult* Hit = Datum.OutHits.FindByPredicate([](const FHitResult& OutHit) { return OutHit.bBlockingHit; });
+		FFootTrace& Foot = FootIKInput.Feet[i % 2];
+		if (i < 2)
+		{
+			Foot.bCapsuleHit = Hit != nullptr;
+			Foot.CapsuleDistance = Hit ? Hit->Distance : 0.f;
+		}
+		else
+		{
+			Foot.FootDistance = Hit ? Hit->Distance : 999.f;
+			Foot.FootNormal = Hit ? Hit->ImpactNormal : FVector::ZeroVector;
+		}
+	}
 }
 
-TTuple<bool, float, FVector> UAnimInstance_TPS::FootLineTrace(FName SocketName, ACharacter* Char)
+void UAnimInstance_TPS::RequestFootTraces()
 {
-	const FVector SocketLocation{ Char->GetMesh()->GetSocketLocation(SocketName) };
-	const FVector RootLocation(Char->GetMesh()->GetSocketLocation("root"));
-
-	const FVector Start{ SocketLocation.X,SocketLocation.Y,RootLocation.Z };
+	for (const FTraceHandle& Handle : FootTraceHandles)
+	{
+		if (Handle.IsValid()) return;
+	}
 
-	FHitResult HitResult;
+	// Standing still the floor under the feet does not change
+	const FVector Location = Character->GetActorLocation();
+	const float Yaw = Character->GetActorRotation().Yaw;
+	if (bHasFootTraces && FVector::DistSquared(Location, LastTraceLocation) < 1.f && FMath::Abs(FRotator::NormalizeAxis(Yaw - LastTraceYaw)) < 1.f) return;
 
-	UKismetSystemLibrary::LineTraceSingle(
-		this,
-		Start + FVector(0.f, 0.f, 105.f),
-		Start + FVector(0.f, 0.f, -105.f),
-		ETraceTypeQuery::TraceTypeQuery1,
-		false,
-		IgnoreActors,
-		EDrawDebugTrace::None,
-		HitResult,
-		false);
+	LastTraceLocation = Location;
+	LastTraceYaw = Yaw;
+	bHasFootTraces = true;
 
-	const bool Result(HitResult.bBlockingHit);
+	USkeletalMeshComponent* Mesh = GetSkelMeshComponent();
+	const float CapsuleZ = Mesh->GetComponentLocation().Z + 98.f;
+	const float RootZ = Mesh->GetSocketLocation("root").Z;
 
-	if (HitResult.bBlockingHit)
+	const FName FootSockets[2] = { TEXT("foot_r"), TEXT("foot_l") };
+	for (int32 i = 0; i < 2; ++i)
 	{
-		return MakeTuple(Result, HitResult.Distance, HitResult.Normal);
+		const FVector SocketLocation = Mesh->GetSocketLocation(FootSockets[i]);
+
+		const FVector CapsuleStart{ SocketLocation.X, SocketLocation.Y, CapsuleZ };
+		RequestFootTrace(i, CapsuleStart, CapsuleStart - FVector(0.f, 0.f, 151.f));
+
+		const FVector FootStart{ SocketLocation.X, SocketLocation.Y, RootZ };
+		RequestFootTrace(i + 2, FootStart + FVector(0.f, 0.f, 105.f), FootStart + FVector(0.f, 0.f, -105.f));
 	}
-	else
+}
+
+void UAnimInstance_TPS::RequestFootTrace(int32 TraceIndex, const FVector& Start, const FVector& End)
+{
+	UWorld* World = GetWorld();
+	INC_DWORD_STAT(STAT_FootIKTraces);
+
+	// A foot over a floor portal stands on whatever is below the other side
+	UPortalSubsystem* PortalSubsystem = World->GetSubsystem<UPortalSubsystem>();
+	float CrossTime;
+	if (PortalSubsystem && PortalSubsystem->FindPortalCrossing(Start, End, CrossTime))
 	{
-		return MakeTuple(Result, 999.f, FVector::ZeroVector);
+		FPortalTraceResult TraceResult;
+		const bool bHit = PortalSubsystem->LineTraceThroughPortals(Start, End, ECollisionChannel::ECC_Visibility, GetFootTraceParams(), TraceResult);
+
+		FFootTrace& Foot = FootIKInput.Feet[TraceIndex % 2];
+		if (TraceIndex < 2)
+		{
+			Foot.bCapsuleHit = bHit;
+			Foot.CapsuleDistance = bHit ? TraceResult.Distance : 0.f;
+		}
+		else
+		{
+			Foot.FootDistance = bHit ? TraceResult.Distance : 999.f;
+			Foot.FootNormal = bHit ? TraceResult.TraceImpactNormal : FVector::ZeroVector;
+		}
+		return;
 	}
+
+	FootTraceHandles[TraceIndex] = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, ECollisionChannel::ECC_Visibility, GetFootTraceParams());
+}
+
+FCollisionQueryParams UAnimInstance_TPS::GetFootTraceParams() const
+{
+	return FCollisionQueryParams(SCENE_QUERY_STAT(FootIK), false, Character);
 }
@@ -4,16 +4,61 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
 #include "AnimInstance_TPS.generated.h"
 
+// What the floor traces under one foot found
+struct FFootTrace
+{
+	// From the hip height down, sets the pelvis displacement
+	bool bCapsuleHit = false;
+	float CapsuleDistance = 0.f;
+
+	// Around the root height, sets the foot offset and its rotation
+	float FootDistance = 999.f;
+	FVector FootNormal = FVector::ZeroVector;
+};
+
+// Everything the foot IK needs from the game thread
+struct FFootIKInput
+{
+	// Off in the air, far away or off screen, the feet relax to the animation
+	bool bActive = false;
+
+	// Right, left
+	FFootTrace Feet[2];
+};
+
+USTRUCT()
+struct TPS_API FAnimInstanceProxy_TPS : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FAnimInstanceProxy_TPS() {}
+	FAnimInstanceProxy_TPS(UAnimInstance* InAnimInstance) : FAnimInstanceProxy(InAnimInstance) {}
+
+	// Written by UAnimInstance_TPS::NativeUpdateAnimation on the game thread
+	FFootIKInput FootIKInput;
+
+protected:
+
+	// Worker thread
+	virtual void Update(float DeltaSeconds) override;
+};
+
 /**
- * 
+ * Foot IK is split between the threads. The game thread only queues async
+ * floor traces and reads last frame's results, the interpolation runs in the
+ * proxy's worker thread update. Traces are skipped while the character
+ * stands still, and IK is off for characters past MaxFootIKLOD or not
+ * rendered lately. A foot over a floor portal is traced through it right
+ * away, async traces cannot follow portals.
  */
 UCLASS()
 class TPS_API UAnimInstance_TPS : public UAnimInstance
 {
 	GENERATED_BODY()
-	
+
 public:
 
 	UAnimInstance_TPS();
@@ -22,12 +67,25 @@ public:
 
 	virtual void NativeUpdateAnimation(float DeltaSeconds) override;
 
-	void FootIK(float DeltaTime);
+	// Worker thread, only touches the IK properties
+	void FootIK(float DeltaTime, const FFootIKInput& Input);
+
+protected:
+
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override;
+
+private:
 
-	TTuple<bool, float> CapsuleDistance(FName SocketName, ACharacter* Char);
+	bool IsFootIKRelevant() const;
 
-	TTuple<bool, float, FVector> FootLineTrace(FName SocketName, ACharacter* Char);
+	void ReadFootTraces();
 
+	void RequestFootTraces();
+
+	// Async unless the trace enters a portal, then it is traced through it now
+	void RequestFootTrace(int32 TraceIndex, const FVector& Start, const FVector& End);
+
+	FCollisionQueryParams GetFootTraceParams() const;
 
 private:
 
@@ -46,8 +104,19 @@ private:
 	UPROPERTY()
 	class ATPSCharacter* Character;
 
-	UPROPERTY()
-	TArray<AActor*> IgnoreActors;
+	// Capsule right, capsule left, foot right, foot left
+	FTraceHandle FootTraceHandles[4];
+
+	FFootIKInput FootIKInput;
+
+	// Where the character stood for the last traces
+	FVector LastTraceLocation;
+	float LastTraceYaw;
+	bool bHasFootTraces;
+
+	// Highest mesh LOD that still gets foot IK
+	UPROPERTY(EditDefaultsOnly, Category = "IK")
+	int32 MaxFootIKLOD;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "IK", meta = (AllowPrivateAccess = "true"))
 		float Displacement;
@@ -2,7 +2,7 @@
 
 
 #include "DoorPlatform.h"
-#include "Components/TimelineComponent.h"
+#include "LaserSubsystem.h"
 
 ADoorPlatform::ADoorPlatform()
 {
@@ -47,6 +47,10 @@ void ADoorPlatform::AddActiveTrigger()
 		}
 		Door->SetMaterial(0, MI_DoorOpen);
 		Door->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+		ULaserSubsystem* LaserSubsystem = GetWorld()->GetSubsystem<ULaserSubsystem>();
+		if (LaserSubsystem)
+			LaserSubsystem->InvalidateComponent(Door);
 	}
 }
 
@@ -64,5 +68,9 @@ void ADoorPlatform::RemoveActiveTrigger()
 		}
 		Door->SetMaterial(0, MI_DoorClose);
 		Door->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+
+		ULaserSubsystem* LaserSubsystem = GetWorld()->GetSubsystem<ULaserSubsystem>();
+		if (LaserSubsystem)
+			LaserSubsystem->InvalidateComponent(Door);
 	}
 }
\ No newline at end of file
@@ -4,7 +4,6 @@
 
 #include "CoreMinimal.h"
 #include "BasicPlatform.h"
-#include "Components/TimelineComponent.h"
 #include "DoorPlatform.generated.h"
 
 /**
@@ -6,12 +6,17 @@
 #include "TextureResource.h"
 #include "CanvasItem.h"
 #include "UObject/ConstructorHelpers.h"
+#include "GameFramework/Pawn.h"
+#include "PlayerAimComponent.h"
 
 AFPSHUD::AFPSHUD()
 {
 	// Set the crosshair texture
 	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshairTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
 	CrosshairTex = CrosshairTexObj.Object;
+
+	PortalWallColor = FLinearColor(0.3f, 0.7f, 1.f);
+	GrabableColor = FLinearColor(0.4f, 1.f, 0.4f);
 }
 
 
@@ -29,7 +34,24 @@ void AFPSHUD::DrawHUD()
 										   (Center.Y -8.f));
 
 	// draw the crosshair
-	FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, FLinearColor::White);
+	FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, GetCrosshairColor());
 	TileItem.BlendMode = SE_BLEND_Translucent;
 	Canvas->DrawItem( TileItem );
 }
+
+FLinearColor AFPSHUD::GetCrosshairColor() const
+{
+	APawn* Pawn = GetOwningPawn();
+	UPlayerAimComponent* Aim = Pawn ? Pawn->FindComponentByClass<UPlayerAimComponent>() : nullptr;
+	if (Aim == nullptr) return FLinearColor::White;
+
+	// Read from the aim cache, the character traced both channels this frame already
+	EAimTargetType GrabTarget = Aim->GetAim(EAimChannel::Grab).TargetType;
+	if (GrabTarget == EAimTargetType::GRABABLE || GrabTarget == EAimTargetType::LASER_CUBE)
+		return GrabableColor;
+
+	if (Aim->GetAim(EAimChannel::Portal).TargetType == EAimTargetType::PORTAL_WALL)
+		return PortalWallColor;
+
+	return FLinearColor::White;
+}
@@ -18,8 +18,18 @@ public:
 	virtual void DrawHUD() override;
 
 private:
+	FLinearColor GetCrosshairColor() const;
+
 	/** Crosshair asset pointer */
 	class UTexture2D* CrosshairTex;
 
+	/** Crosshair tint over a wall a portal can be shot at */
+	UPROPERTY(EditDefaultsOnly, Category = "Crosshair")
+	FLinearColor PortalWallColor;
+
+	/** Crosshair tint over something in grab range */
+	UPROPERTY(EditDefaultsOnly, Category = "Crosshair")
+	FLinearColor GrabableColor;
+
 };
 
@@ -2,19 +2,17 @@
 
 
 #include "FloatingActor.h"
-#include "Components/TimelineComponent.h"
+#include "TweenSubsystem.h"
 
 // Sets default values
 AFloatingActor::AFloatingActor()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 
 	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MESH"));
 	RootComponent = Mesh;
 
-	FloatingTimeline = CreateDefaultSubobject<UTimelineComponent>(TEXT("TIMELINE"));
-
 }
 
 // Called when the game starts or when spawned
@@ -22,65 +20,34 @@ void AFloatingActor::BeginPlay()
 {
 	Super::BeginPlay();
 	
-	if (HasAuthority())
-	{
-		SetReplicates(true);
-		SetReplicateMovement(true);
-	}
+	// Clients follow the replicated movement
+	if (HasAuthority() == false) return;
+
+	SetReplicates(true);
+	SetReplicateMovement(true);
 
 	GlobalStartLocation = GetActorLocation();
 	GlobalTargetLocation = GlobalStartLocation + TargetLocation;
 
-	if (FloatingTimeline)
-	{
-		FloatingTimeline->Play();
-	}
-}
-
-void AFloatingActor::PostInitializeComponents()
-{
-	Super::PostInitializeComponents();
+	UTweenSubsystem* TweenSubsystem = GetWorld()->GetSubsystem<UTweenSubsystem>();
+	if (TweenSubsystem == nullptr) return;
 
-	UpdateFunction.BindUFunction(this, FName("TimelineUpdate"));
-	FinishedFunction.BindUFunction(this, FName("TimelineFinish"));
+	FTweenSettings Settings;
+	Settings.Curve = FloatCurve;
+	Settings.Duration = FloatCurve ? 0.f : 1.f;
+	Settings.bPingPong = true;
 
-	if (FloatingTimeline)
-	{
-		FloatingTimeline->AddInterpFloat(FloatCurve, UpdateFunction);
-		FloatingTimeline->SetTimelineFinishedFunc(FinishedFunction);
-		FloatingTimeline->SetLooping(false);
-	}
-}
-
-// Called every frame
-void AFloatingActor::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-}
-
-void AFloatingActor::TimelineUpdate(float Value)
-{
-	if (HasAuthority())
+	TweenSubsystem->Play(this, Settings, [this](float Value)
 	{
 		SetActorLocation(FMath::Lerp(GlobalStartLocation, GlobalTargetLocation, Value));
-	}
+	});
 }
 
-void AFloatingActor::TimelineFinish()
+void AFloatingActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	if (FloatingTimeline->GetPlaybackPosition() == FloatingTimeline->GetTimelineLength())
-	{
-		FloatingTimeline->Reverse();
-		UE_LOG(LogTemp, Warning, TEXT("Reverse Timeline"));
-	}
-	else if (FloatingTimeline->GetPlaybackPosition() == 0.f)
-	{
-		FloatingTimeline->Play();
-		UE_LOG(LogTemp, Error, TEXT("Play Timeline"));
-	}
+	Super::EndPlay(EndPlayReason);
 
-	
-	//FloatingTimeline->PlayFromStart();
+	UTweenSubsystem* TweenSubsystem = GetWorld()->GetSubsystem<UTweenSubsystem>();
+	if (TweenSubsystem)
+		TweenSubsystem->StopAll(this);
 }
-
@@ -4,7 +4,6 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
-#include "Components/TimelineComponent.h"
 #include "FloatingActor.generated.h"
 
 UCLASS()
@@ -20,28 +19,14 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-	virtual void PostInitializeComponents() override;
-
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
-private:
-
-	UFUNCTION()
-	void TimelineUpdate(float Value);
-
-	UFUNCTION()
-	void TimelineFinish();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 private:
 
 	UPROPERTY(EditAnywhere)
 	UStaticMeshComponent* Mesh;
 
-	UPROPERTY()
-	class UTimelineComponent* FloatingTimeline;
-
+	// Played back and forth between the start and TargetLocation
 	UPROPERTY(EditAnywhere)
 	class UCurveFloat* FloatCurve;
 
@@ -52,7 +37,4 @@ private:
 	FVector GlobalStartLocation;
 
 	FVector GlobalTargetLocation;
-
-	FOnTimelineFloat UpdateFunction;
-	FOnTimelineEvent FinishedFunction;
 };
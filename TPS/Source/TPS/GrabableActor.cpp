@@ -2,6 +2,8 @@
 
 
 #include "GrabableActor.h"
+#include "GameFramework/Character.h"
+#include "Components/PrimitiveComponent.h"
 
 // Sets default values
 AGrabableActor::AGrabableActor()
@@ -9,6 +11,10 @@ AGrabableActor::AGrabableActor()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	// The server simulates, clients smooth towards its state. At rest nothing changes and nothing is sent
+	bReplicates = true;
+	SetReplicateMovement(true);
+	NetUpdateFrequency = 10.f;
 }
 
 // Called when the game starts or when spawned
@@ -18,10 +24,24 @@ void AGrabableActor::BeginPlay()
 	
 }
 
+void AGrabableActor::SetupPortalPhysics(UPrimitiveComponent* PhysicsMesh)
+{
+	// Thrown through a portal it must not tunnel through the wall next to it
+	PhysicsMesh->BodyInstance.bUseCCD = true;
+	// Lets FPortalCollisionFilter drop its contacts with the wall behind a portal
+	PhysicsMesh->BodyInstance.bContactModification = true;
+}
+
 void AGrabableActor::SetVelocity(FVector velocity)
 {
 }
 
+void AGrabableActor::SetCarrier(ACharacter* NewCarrier)
+{
+	Carrier = NewCarrier;
+	SetReplicateMovement(NewCarrier == nullptr);
+}
+
 // Called every frame
 void AGrabableActor::Tick(float DeltaTime)
 {
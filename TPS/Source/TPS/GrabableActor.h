@@ -17,13 +17,25 @@ public:
 
 	virtual void SetVelocity(FVector velocity);
 
+	// Server only, the character holding it or nullptr
+	class ACharacter* GetCarrier() const { return Carrier.Get(); }
+
+	// Movement stops replicating while carried, the carrier replicates its carry target instead
+	void SetCarrier(class ACharacter* NewCarrier);
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Sets up the simulated mesh of a subclass to go through portals
+	static void SetupPortalPhysics(class UPrimitiveComponent* PhysicsMesh);
+
 
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+private:
+
+	TWeakObjectPtr<class ACharacter> Carrier;
 };
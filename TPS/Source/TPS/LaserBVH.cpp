@@ -0,0 +1,279 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserBVH.h"
+#include "Components/PrimitiveComponent.h"
+
+namespace
+{
+	// Axis parallel rays get a huge but finite slope so the slab math never sees 0 * inf
+	float SafeInverse(float Value)
+	{
+		if (FMath::Abs(Value) > SMALL_NUMBER)
+			return 1.f / Value;
+		return Value >= 0.f ? BIG_NUMBER : -BIG_NUMBER;
+	}
+
+	VectorRegister MakeInvDirection(const FVector& Delta)
+	{
+		return MakeVectorRegister(SafeInverse(Delta.X), SafeInverse(Delta.Y), SafeInverse(Delta.Z), 0.f);
+	}
+}
+
+void FLaserBVH::AddActor(AActor* Actor)
+{
+	if (Actor == nullptr) return;
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+		AddComponent(Primitive);
+}
+
+void FLaserBVH::RemoveActor(AActor* Actor)
+{
+	if (Actor == nullptr) return;
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+		RemoveComponent(Primitive);
+}
+
+void FLaserBVH::UpdateCollision(UPrimitiveComponent* Component)
+{
+	if (CanBlockLaser(Component))
+		AddComponent(Component);
+	else
+		RemoveComponent(Component);
+}
+
+bool FLaserBVH::CanBlockLaser(const UPrimitiveComponent* Component)
+{
+	return Component->IsQueryCollisionEnabled() && Component->GetCollisionResponseToChannel(ECollisionChannel::ECC_GameTraceChannel7) == ECR_Block;
+}
+
+void FLaserBVH::AddComponent(UPrimitiveComponent* Component)
+{
+	if (Component == nullptr || Component->IsRegistered() == false || LeafIndices.Contains(Component)) return;
+
+	// Switching its collision on later adds it through UpdateCollision
+	if (CanBlockLaser(Component) == false) return;
+
+	FLaserBVHLeaf& Leaf = Leaves.AddDefaulted_GetRef();
+	Leaf.Component = Component;
+	Leaf.Node = INDEX_NONE;
+	RefreshLeaf(Leaf);
+
+	LeafIndices.Add(Component, Leaves.Num() - 1);
+	bNeedsBuild = true;
+}
+
+void FLaserBVH::RemoveComponent(UPrimitiveComponent* Component)
+{
+	int32 LeafIndex = INDEX_NONE;
+	if (LeafIndices.RemoveAndCopyValue(Component, LeafIndex))
+	{
+		// Skipped by traces until the next build drops it
+		Leaves[LeafIndex].Component.Reset();
+		bNeedsBuild = true;
+	}
+}
+
+void FLaserBVH::UpdateComponent(UPrimitiveComponent* Component)
+{
+	const int32* LeafIndex = LeafIndices.Find(Component);
+	if (LeafIndex == nullptr) return;
+
+	FLaserBVHLeaf& Leaf = Leaves[*LeafIndex];
+	RefreshLeaf(Leaf);
+
+	if (bNeedsBuild || Nodes.IsValidIndex(Leaf.Node) == false) return;
+
+	SetNodeBox(Nodes[Leaf.Node], Leaf.WorldBox);
+	RefitUp(Nodes[Leaf.Node].Parent);
+}
+
+void FLaserBVH::Reset()
+{
+	Leaves.Reset();
+	Nodes.Reset();
+	LeafIndices.Reset();
+	bNeedsBuild = false;
+}
+
+void FLaserBVH::RefreshLeaf(FLaserBVHLeaf& Leaf) const
+{
+	UPrimitiveComponent* Component = Leaf.Component.Get();
+	if (Component == nullptr) return;
+
+	// A unit of slack so hits on the very surface still fall inside the box
+	Leaf.Transform = Component->GetComponentTransform();
+	Leaf.LocalBox = Component->CalcBounds(FTransform::Identity).GetBox().ExpandBy(1.f);
+	Leaf.WorldBox = Leaf.LocalBox.TransformBy(Leaf.Transform);
+}
+
+void FLaserBVH::Build()
+{
+	if (bNeedsBuild == false) return;
+	bNeedsBuild = false;
+
+	Leaves.RemoveAllSwap([](const FLaserBVHLeaf& Leaf) { return Leaf.Component.IsValid() == false; });
+	Nodes.Reset();
+
+	if (Leaves.Num() > 0)
+	{
+		Nodes.AddDefaulted();
+		BuildNode(0, INDEX_NONE, 0, Leaves.Num());
+	}
+
+	// Building reorders the leaves
+	LeafIndices.Reset();
+	for (int32 i = 0; i < Leaves.Num(); ++i)
+		LeafIndices.Add(Leaves[i].Component.Get(), i);
+}
+
+void FLaserBVH::BuildNode(int32 NodeIndex, int32 Parent, int32 First, int32 Last)
+{
+	FBox Box(ForceInit);
+	FBox Centers(ForceInit);
+	for (int32 i = First; i < Last; ++i)
+	{
+		Box += Leaves[i].WorldBox;
+		Centers += Leaves[i].WorldBox.GetCenter();
+	}
+
+	Nodes[NodeIndex].Parent = Parent;
+	SetNodeBox(Nodes[NodeIndex], Box);
+
+	if (Last - First == 1)
+	{
+		Nodes[NodeIndex].Child = INDEX_NONE;
+		Nodes[NodeIndex].Leaf = First;
+		Leaves[First].Node = NodeIndex;
+		return;
+	}
+
+	// Median split along the axis the centers spread the most on
+	const FVector Extent = Centers.GetExtent();
+	const int32 Axis = Extent.X >= Extent.Y && Extent.X >= Extent.Z ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+	Sort(Leaves.GetData() + First, Last - First, [Axis](const FLaserBVHLeaf& A, const FLaserBVHLeaf& B)
+	{
+		return A.WorldBox.GetCenter()[Axis] < B.WorldBox.GetCenter()[Axis];
+	});
+
+	const int32 Mid = (First + Last) / 2;
+	const int32 Child = Nodes.AddDefaulted(2);
+	Nodes[NodeIndex].Child = Child;
+	Nodes[NodeIndex].Leaf = INDEX_NONE;
+
+	BuildNode(Child, NodeIndex, First, Mid);
+	BuildNode(Child + 1, NodeIndex, Mid, Last);
+}
+
+void FLaserBVH::SetNodeBox(FLaserBVHNode& Node, const FBox& Box) const
+{
+	Node.Min = FVector4(Box.Min, 0.f);
+	Node.Max = FVector4(Box.Max, 0.f);
+}
+
+void FLaserBVH::RefitUp(int32 NodeIndex)
+{
+	while (NodeIndex != INDEX_NONE)
+	{
+		FLaserBVHNode& Node = Nodes[NodeIndex];
+		const FLaserBVHNode& A = Nodes[Node.Child];
+		const FLaserBVHNode& B = Nodes[Node.Child + 1];
+
+		VectorStore(VectorMin(VectorLoad(&A.Min.X), VectorLoad(&B.Min.X)), &Node.Min.X);
+		VectorStore(VectorMax(VectorLoad(&A.Max.X), VectorLoad(&B.Max.X)), &Node.Max.X);
+
+		NodeIndex = Node.Parent;
+	}
+}
+
+FBox FLaserBVH::GetBounds() const
+{
+	if (Nodes.Num() == 0) return FBox(ForceInit);
+
+	return FBox(FVector(Nodes[0].Min), FVector(Nodes[0].Max));
+}
+
+bool FLaserBVH::IntersectBox(const VectorRegister& Origin, const VectorRegister& InvDirection, const FVector4& BoxMin, const FVector4& BoxMax, float& OutEnter)
+{
+	// Slab test on all three axes at once, t is the fraction of the segment
+	const VectorRegister T1 = VectorMultiply(VectorSubtract(VectorLoad(&BoxMin.X), Origin), InvDirection);
+	const VectorRegister T2 = VectorMultiply(VectorSubtract(VectorLoad(&BoxMax.X), Origin), InvDirection);
+	const VectorRegister Near = VectorMin(T1, T2);
+	const VectorRegister Far = VectorMax(T1, T2);
+
+	const float Enter = FMath::Max(FMath::Max3(VectorGetComponent(Near, 0), VectorGetComponent(Near, 1), VectorGetComponent(Near, 2)), 0.f);
+	const float Exit = FMath::Min(FMath::Min3(VectorGetComponent(Far, 0), VectorGetComponent(Far, 1), VectorGetComponent(Far, 2)), 1.f);
+
+	OutEnter = Enter;
+	return Enter <= Exit;
+}
+
+bool FLaserBVH::LineTrace(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params) const
+{
+	if (Nodes.Num() == 0) return false;
+
+	const VectorRegister Origin = MakeVectorRegister(Start.X, Start.Y, Start.Z, 0.f);
+	const VectorRegister InvDirection = MakeInvDirection(End - Start);
+
+	TArray<FLaserBVHCandidate, TInlineAllocator<16>> Candidates;
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Push(0);
+
+	while (Stack.Num() > 0)
+	{
+		const FLaserBVHNode& Node = Nodes[Stack.Pop(false)];
+
+		float Enter;
+		if (IntersectBox(Origin, InvDirection, Node.Min, Node.Max, Enter) == false) continue;
+
+		if (Node.Child != INDEX_NONE)
+		{
+			Stack.Push(Node.Child);
+			Stack.Push(Node.Child + 1);
+			continue;
+		}
+
+		// The node box is axis aligned, test the oriented box in the leaf's own space as well
+		const FLaserBVHLeaf& Leaf = Leaves[Node.Leaf];
+		if (Leaf.Component.IsValid() == false) continue;
+
+		const FVector LocalStart = Leaf.Transform.InverseTransformPosition(Start);
+		const FVector LocalEnd = Leaf.Transform.InverseTransformPosition(End);
+		const VectorRegister LocalOrigin = MakeVectorRegister(LocalStart.X, LocalStart.Y, LocalStart.Z, 0.f);
+
+		if (IntersectBox(LocalOrigin, MakeInvDirection(LocalEnd - LocalStart), FVector4(Leaf.LocalBox.Min, 0.f), FVector4(Leaf.LocalBox.Max, 0.f), Enter))
+			Candidates.Add({ Node.Leaf, Enter });
+	}
+
+	Candidates.Sort([](const FLaserBVHCandidate& A, const FLaserBVHCandidate& B) { return A.Enter < B.Enter; });
+
+	// Front to back, nothing entered after the best hit can be in front of it
+	bool bHit = false;
+	float BestTime = 1.f;
+	for (const FLaserBVHCandidate& Candidate : Candidates)
+	{
+		if (Candidate.Enter > BestTime) break;
+
+		UPrimitiveComponent* Component = Leaves[Candidate.Leaf].Component.Get();
+		if (Component == nullptr) continue;
+		if (Component->IsQueryCollisionEnabled() == false) continue;
+		if (Component->GetCollisionResponseToChannel(TraceChannel) != ECR_Block) continue;
+
+		const AActor* Owner = Component->GetOwner();
+		if (Owner && Params.GetIgnoredActors().Contains(Owner->GetUniqueID())) continue;
+
+		FHitResult HitResult;
+		if (Component->LineTraceComponent(HitResult, Start, End, Params) && HitResult.Time <= BestTime)
+		{
+			OutHit = HitResult;
+			BestTime = HitResult.Time;
+			bHit = true;
+		}
+	}
+
+	return bHit;
+}
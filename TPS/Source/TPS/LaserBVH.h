@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+/**
+ * Bounding volume hierarchy over the primitives a laser can hit, kept by
+ * ULaserSubsystem next to the physics scene. Nodes are world space boxes,
+ * leaves are the oriented local bounds of one component, both tested with
+ * vector slab tests. Candidates are then confirmed front to back with
+ * LineTraceComponent, so hits match a channel trace through the whole scene.
+ * Only components blocking the laser channel get a leaf, UpdateCollision
+ * adds or drops one when that changes. Moving a leaf refits its parents,
+ * only adding or removing one rebuilds.
+ */
+class TPS_API FLaserBVH
+{
+public:
+
+	void AddActor(AActor* Actor);
+	void RemoveActor(AActor* Actor);
+
+	// Refits the leaf of Component after it moved
+	void UpdateComponent(UPrimitiveComponent* Component);
+
+	// Adds or drops Component after its collision changed
+	void UpdateCollision(UPrimitiveComponent* Component);
+
+	// Query collision on and blocking the laser channel
+	static bool CanBlockLaser(const UPrimitiveComponent* Component);
+
+	void Reset();
+
+	// Rebuilds the tree if components came or went since the last build, game thread only
+	void Build();
+
+	bool NeedsBuild() const { return bNeedsBuild; }
+
+	// Same contract as UWorld::LineTraceSingleByChannel. Safe on any thread while nothing is added, moved or built
+	bool LineTrace(FHitResult& OutHit, const FVector& Start, const FVector& End, ECollisionChannel TraceChannel, const FCollisionQueryParams& Params) const;
+
+	int32 GetNumLeaves() const { return Leaves.Num(); }
+	FBox GetBounds() const;
+
+private:
+
+	struct FLaserBVHLeaf
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Component;
+		FTransform Transform;
+		FBox LocalBox;
+		FBox WorldBox;
+		int32 Node;
+	};
+
+	// Leaf nodes have Child == INDEX_NONE and keep their leaf in Leaf, inner nodes own Child and Child + 1
+	struct FLaserBVHNode
+	{
+		FVector4 Min;
+		FVector4 Max;
+		int32 Parent;
+		int32 Child;
+		int32 Leaf;
+	};
+
+	struct FLaserBVHCandidate
+	{
+		int32 Leaf;
+		float Enter;
+	};
+
+	void AddComponent(UPrimitiveComponent* Component);
+	void RemoveComponent(UPrimitiveComponent* Component);
+	void RefreshLeaf(FLaserBVHLeaf& Leaf) const;
+	void BuildNode(int32 NodeIndex, int32 Parent, int32 First, int32 Last);
+	void SetNodeBox(FLaserBVHNode& Node, const FBox& Box) const;
+	void RefitUp(int32 NodeIndex);
+
+	static bool IntersectBox(const VectorRegister& Origin, const VectorRegister& InvDirection, const FVector4& BoxMin, const FVector4& BoxMax, float& OutEnter);
+
+	TArray<FLaserBVHLeaf> Leaves;
+	TArray<FLaserBVHNode> Nodes;
+	TMap<TObjectKey<UPrimitiveComponent>, int32> LeafIndices;
+
+	bool bNeedsBuild = false;
+};
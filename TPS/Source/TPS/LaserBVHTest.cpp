@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "StandaloneGameWorld.h"
+#include "LaserBVH.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLaserBVHMatchesPhysicsTest, "TPS.Laser.BVHMatchesPhysics", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+namespace
+{
+	const TCHAR* BVHTestClassPaths[] =
+	{
+		TEXT("Class'/Game/Platforms/BP_MirrorCube.BP_MirrorCube_C'"),
+		TEXT("Class'/Game/Platforms/BP_LaserCube.BP_LaserCube_C'"),
+		TEXT("Class'/Game/Portal/BP_Portal.BP_Portal_C'"),
+		TEXT("Class'/Game/Portal/BP_PortalWall.BP_PortalWall_C'"),
+	};
+
+	// Rays whose BVH hit differs from the physics scene's in result, component or impact point
+	int32 CountMismatches(UWorld* World, const FLaserBVH& BVH, FRandomStream& RandomStream, int32 NumRays)
+	{
+		const FBox Bounds = BVH.GetBounds();
+		const FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, true);
+
+		int32 Mismatches = 0;
+		for (int32 i = 0; i < NumRays; ++i)
+		{
+			const FVector Start = RandomStream.RandPointInBox(Bounds);
+			const FVector End = Start + RandomStream.VRand() * 10000.f;
+
+			FHitResult PhysicsHit;
+			const bool PhysicsResult = World->LineTraceSingleByChannel(PhysicsHit, Start, End, ECollisionChannel::ECC_GameTraceChannel7, QueryParam);
+
+			FHitResult HitResult;
+			const bool Result = BVH.LineTrace(HitResult, Start, End, ECollisionChannel::ECC_GameTraceChannel7, QueryParam);
+
+			if (Result != PhysicsResult || (Result && (HitResult.GetComponent() != PhysicsHit.GetComponent() || FVector::DistSquared(HitResult.ImpactPoint, PhysicsHit.ImpactPoint) > 1.f)))
+				++Mismatches;
+		}
+		return Mismatches;
+	}
+}
+
+bool FLaserBVHMatchesPhysicsTest::RunTest(const FString& Parameters)
+{
+	TArray<UClass*> Classes;
+	for (const TCHAR* ClassPath : BVHTestClassPaths)
+	{
+		UClass* ActorClass = FStandaloneGameWorld::LoadClass(ClassPath);
+		if (TestNotNull(ClassPath, ActorClass) == false)
+			return false;
+		Classes.Add(ActorClass);
+	}
+
+	FStandaloneGameWorld GameWorld(TEXT("LaserBVHTest"));
+	UWorld* World = GameWorld.Get();
+
+	// Every laser relevant shape scattered and turned at random, fixed seed so failures reproduce
+	FRandomStream RandomStream(7);
+	const FBox SceneBounds(FVector(-2000.f, -2000.f, 0.f), FVector(2000.f, 2000.f, 1000.f));
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<AActor*> SceneActors;
+	for (int32 i = 0; i < 64; ++i)
+	{
+		const FTransform Transform(FRotator(RandomStream.FRandRange(-90.f, 90.f), RandomStream.FRandRange(-180.f, 180.f), 0.f), RandomStream.RandPointInBox(SceneBounds));
+		AActor* Actor = World->SpawnActor<AActor>(Classes[i % Classes.Num()], Transform, SpawnParameters);
+		if (Actor == nullptr) continue;
+
+		// Bodies must hold still between the two traces
+		if (UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Actor->GetRootComponent()))
+			Root->SetSimulatePhysics(false);
+		SceneActors.Add(Actor);
+	}
+
+	FLaserBVH BVH;
+	for (TActorIterator<AActor> It(World); It; ++It)
+		BVH.AddActor(*It);
+	BVH.Build();
+
+	TestTrue(TEXT("BVH has leaves"), BVH.GetNumLeaves() > 0);
+	TestEqual(TEXT("Mismatches after the build"), CountMismatches(World, BVH, RandomStream, 4096), 0);
+
+	// Moved leaves are refit, not rebuilt
+	for (int32 i = 0; i < SceneActors.Num(); i += 2)
+	{
+		SceneActors[i]->SetActorLocationAndRotation(RandomStream.RandPointInBox(SceneBounds), FRotator(0.f, RandomStream.FRandRange(-180.f, 180.f), 0.f));
+
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(SceneActors[i]);
+		for (UPrimitiveComponent* Primitive : Primitives)
+			BVH.UpdateComponent(Primitive);
+	}
+
+	TestFalse(TEXT("Refit needs no build"), BVH.NeedsBuild());
+	TestEqual(TEXT("Mismatches after the refit"), CountMismatches(World, BVH, RandomStream, 4096), 0);
+
+	return true;
+}
+
+#endif
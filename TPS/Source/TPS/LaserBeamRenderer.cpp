@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserBeamRenderer.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+ULaserBeamRenderer::ULaserBeamRenderer()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+
+	SegmentScale = FVector(5.f, 5.f, 0.f);
+}
+
+void ULaserBeamRenderer::SetBeam(UParticleSystem* beamTemplate, USceneComponent* attachParent)
+{
+	BeamTemplate = beamTemplate;
+	AttachParent = attachParent;
+}
+
+void ULaserBeamRenderer::DrawBeam(const FLaserPath& Path)
+{
+	const int32 SegmentNum = Path.Segments.Num();
+	for (int32 i = 0; i < SegmentNum; ++i)
+	{
+		UParticleSystemComponent* Segment = GetOrSpawnSegment(i);
+		if (Segment == nullptr)
+		{
+			SetActiveSegmentNum(i);
+			return;
+		}
+
+		const FLaserSegment& LaserSegment = Path.Segments[i];
+		if (i >= ActiveSegmentNum)
+		{
+			Segment->Activate(true);
+			Segment->SetBeamSourcePoint(0, LaserSegment.Start, 0);
+			Segment->SetBeamEndPoint(0, LaserSegment.End);
+			DrawnSegments[i] = LaserSegment;
+			continue;
+		}
+
+		// Only push points the particle system has not seen yet, a stable beam touches nothing
+		if (DrawnSegments[i].Start != LaserSegment.Start)
+		{
+			Segment->SetBeamSourcePoint(0, LaserSegment.Start, 0);
+			DrawnSegments[i].Start = LaserSegment.Start;
+		}
+		if (DrawnSegments[i].End != LaserSegment.End)
+		{
+			Segment->SetBeamEndPoint(0, LaserSegment.End);
+			DrawnSegments[i].End = LaserSegment.End;
+		}
+	}
+
+	SetActiveSegmentNum(SegmentNum);
+}
+
+void ULaserBeamRenderer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	for (UParticleSystemComponent* Segment : Segments)
+	{
+		if (Segment)
+			Segment->DestroyComponent();
+	}
+	Segments.Empty();
+	DrawnSegments.Empty();
+	ActiveSegmentNum = 0;
+}
+
+UParticleSystemComponent* ULaserBeamRenderer::GetOrSpawnSegment(int32 Index)
+{
+	if (Segments.IsValidIndex(Index))
+		return Segments[Index];
+
+	if (BeamTemplate == nullptr || AttachParent == nullptr) return nullptr;
+
+	UParticleSystemComponent* Segment = UGameplayStatics::SpawnEmitterAttached(BeamTemplate, AttachParent, NAME_None,
+		FVector::ZeroVector, FRotator::ZeroRotator, EAttachLocation::KeepRelativeOffset, false);
+	if (Segment == nullptr) return nullptr;
+
+	Segment->SetRelativeScale3D(SegmentScale);
+
+	Segments.Add(Segment);
+	DrawnSegments.Add({ FVector::ZeroVector, FVector::ZeroVector });
+
+	// Stays inactive until DrawBeam hands it a segment
+	Segment->DeactivateImmediate();
+
+	return Segment;
+}
+
+void ULaserBeamRenderer::SetActiveSegmentNum(int32 Num)
+{
+	for (int32 i = Num; i < ActiveSegmentNum; ++i)
+		Segments[i]->DeactivateImmediate();
+
+	ActiveSegmentNum = Num;
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LaserPath.h"
+#include "LaserBeamRenderer.generated.h"
+
+/**
+ * Keeps a pool of beam particle components for one laser and only moves them.
+ * Segments are spawned the first time the path grows past the pool and are
+ * never destroyed while the owner lives; unused ones are just deactivated.
+ */
+UCLASS(ClassGroup = (Laser))
+class TPS_API ULaserBeamRenderer : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	ULaserBeamRenderer();
+
+	void SetBeam(class UParticleSystem* beamTemplate, USceneComponent* attachParent);
+
+	void DrawBeam(const FLaserPath& Path);
+
+	int32 GetActiveSegmentNum() const { return ActiveSegmentNum; }
+
+protected:
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+
+	class UParticleSystemComponent* GetOrSpawnSegment(int32 Index);
+
+	void SetActiveSegmentNum(int32 Num);
+
+private:
+
+	UPROPERTY()
+	class UParticleSystem* BeamTemplate;
+
+	UPROPERTY()
+	USceneComponent* AttachParent;
+
+	UPROPERTY(VisibleInstanceOnly)
+	TArray<class UParticleSystemComponent*> Segments;
+
+	TArray<FLaserSegment> DrawnSegments;
+
+	UPROPERTY(VisibleInstanceOnly)
+	int32 ActiveSegmentNum;
+
+	UPROPERTY(EditDefaultsOnly)
+	FVector SegmentScale;
+};
@@ -3,6 +3,7 @@
 
 #include "LaserCube.h"
 #include "Components/ArrowComponent.h"
+#include "Net/UnrealNetwork.h"
 
 ALaserCube::ALaserCube()
 {
@@ -14,6 +15,7 @@ ALaserCube::ALaserCube()
 	CubeMesh->SetCollisionProfileName(TEXT("PhysicsActor"));
 	RootComponent->SetMobility(EComponentMobility::Movable);
 	CubeMesh->SetSimulatePhysics(true);
+	SetupPortalPhysics(CubeMesh);
 
 	Glass = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("GLASS"));
 	Glass->SetupAttachment(RootComponent);
@@ -27,6 +29,12 @@ ALaserCube::ALaserCube()
 	Arrow->SetupAttachment(RootComponent);
 	Arrow->SetRelativeLocation(FVector(50.f, 0.f, 0.f));
 
+	bSplitBeam = false;
+	SplitAngle = 45.f;
+
+	// The core state, movement replicates like every other grabable actor
+	bReplicates = true;
+
 
 }
 
@@ -46,21 +54,74 @@ void ALaserCube::Tick(float DeltaTime)
 
 void ALaserCube::CoreOn()
 {
-	if (MI_Core_On)
-		Core->SetMaterial(0, MI_Core_On);
-
 	bIsCoreOn = true;
+	SetCoreMaterial();
 }
 
 void ALaserCube::CoreOff()
 {
-	if (MI_Core_Off)
-		Core->SetMaterial(0, MI_Core_Off);
-
 	bIsCoreOn = false;
+	SetCoreMaterial();
+}
+
+void ALaserCube::OnRep_IsCoreOn()
+{
+	SetCoreMaterial();
+}
+
+void ALaserCube::SetCoreMaterial()
+{
+	UMaterialInterface* CoreMaterial = bIsCoreOn ? MI_Core_On : MI_Core_Off;
+	if (CoreMaterial)
+		Core->SetMaterial(0, CoreMaterial);
+}
+
+void ALaserCube::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ALaserCube, bIsCoreOn);
 }
 
 void ALaserCube::SetVelocity(FVector velocity)
 {
 	CubeMesh->SetPhysicsLinearVelocity(velocity);
 }
+
+ELaserResponse ALaserCube::GetLaserResponse(const UPrimitiveComponent* Component) const
+{
+	return Component == Glass ? ELaserResponse::REDIRECT : ELaserResponse::NONE;
+}
+
+void ALaserCube::GetLaserExits(const FHitResult& HitResult, const FVector& Direction, FLaserExits& OutExits) const
+{
+	const FVector CubeLocation = GetActorLocation();
+	const FVector CubeForward = GetActorForwardVector();
+
+	auto AddExit = [&](const FVector& ExitForward)
+	{
+		FLaserExit& Exit = OutExits.AddDefaulted_GetRef();
+		Exit.bDrawThrough = true;
+		Exit.Through = CubeLocation;
+		Exit.Start = CubeLocation + ExitForward * 50.f;
+		Exit.Direction = ExitForward * 10000.f;
+	};
+
+	if (bSplitBeam == false)
+	{
+		AddExit(CubeForward);
+		return;
+	}
+
+	const FVector CubeUp = GetActorUpVector();
+	AddExit(CubeForward.RotateAngleAxis(SplitAngle, CubeUp));
+	AddExit(CubeForward.RotateAngleAxis(-SplitAngle, CubeUp));
+}
+
+void ALaserCube::SetLaserLit(bool bLit)
+{
+	if (bLit)
+		CoreOn();
+	else
+		CoreOff();
+}
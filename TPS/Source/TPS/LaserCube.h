@@ -4,13 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "GrabableActor.h"
+#include "LaserInteractable.h"
 #include "LaserCube.generated.h"
 
 /**
  * 
  */
 UCLASS()
-class TPS_API ALaserCube : public AGrabableActor
+class TPS_API ALaserCube : public AGrabableActor, public ILaserInteractable
 {
 	GENERATED_BODY()
 	
@@ -31,8 +32,15 @@ public:
 
 	bool GetIsCoreOn() const { return bIsCoreOn; }
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 	virtual void SetVelocity(FVector velocity) override;
 
+	// ILaserInteractable, the glass takes the beam in and the arrow sends it out again
+	virtual ELaserResponse GetLaserResponse(const UPrimitiveComponent* Component) const override;
+	virtual void GetLaserExits(const FHitResult& HitResult, const FVector& Direction, FLaserExits& OutExits) const override;
+	virtual void SetLaserLit(bool bLit) override;
+
 private:
 
 	UPROPERTY(VisibleAnywhere)
@@ -53,5 +61,19 @@ private:
 	UPROPERTY(EditDefaultsOnly)
 		class UMaterialInterface* MI_Core_Off;
 
-	bool bIsCoreOn;
+	// Splits the beam in two, each turned SplitAngle away from the arrow around the cube's up axis
+	UPROPERTY(EditAnywhere, Category = "Laser")
+		bool bSplitBeam;
+
+	UPROPERTY(EditAnywhere, Category = "Laser", meta = (EditCondition = "bSplitBeam", ClampMin = "0", ClampMax = "90"))
+		float SplitAngle;
+
+	// Set by the server's hit registry
+	UPROPERTY(ReplicatedUsing = OnRep_IsCoreOn)
+		bool bIsCoreOn;
+
+	UFUNCTION()
+		void OnRep_IsCoreOn();
+
+	void SetCoreMaterial();
 };
@@ -1,4 +1,4 @@
-// Fill out your copyright notice in the Description page of Project Settings.
+﻿// Fill out your copyright notice in the Description page of Project Settings.
 
 
 #include "LaserGenerator.h"
@@ -9,14 +9,17 @@
 #include "Particles/ParticleSystemComponent.h"
 #include "TPSCharacter.h"
 #include "Components/ArrowComponent.h"
-#include "LaserTrigger.h"
-#include "LaserCube.h"
+#include "LaserBeamRenderer.h"
+#include "LaserSubsystem.h"
+#include "LaserTracer.h"
+#include "LaserHitRegistry.h"
+#include "Net/UnrealNetwork.h"
 
 // Sets default values
 ALaserGenerator::ALaserGenerator()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// ULaserSubsystem traces all generators together, see NeedsTrace / PrepareTrace / TraceLaser / ApplyTrace
+	PrimaryActorTick.bCanEverTick = false;
 
 	Scene = CreateDefaultSubobject<USceneComponent>(TEXT("SCENE"));
 	RootComponent = Scene;
@@ -27,236 +30,299 @@ ALaserGenerator::ALaserGenerator()
 	Muzzle = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MUZZLE"));
 	Muzzle->SetupAttachment(RootComponent);
 
+	BeamRenderer = CreateDefaultSubobject<ULaserBeamRenderer>(TEXT("BEAM RENDERER"));
+
+	bReplicates = true;
+
 	ReflectionCount = 5;
+	SegmentBudget = FLaserPath::MaxSegments;
+	DirtyRayIndex = 0;
+	LastTraceTime = 0.0;
+	PendingTrace.TracedSegments = 0;
+	PendingTrace.TracedRays = 0;
+	PendingTrace.bValid = false;
 }
 
 // Called when the game starts or when spawned
 void ALaserGenerator::BeginPlay()
 {
 	Super::BeginPlay();
+
+	BeamRenderer->SetBeam(Ptl_Laser, Muzzle);
+
+	Muzzle->TransformUpdated.AddUObject(this, &ALaserGenerator::OnMuzzleMoved);
+
+	ULaserSubsystem* LaserSubsystem = GetWorld()->GetSubsystem<ULaserSubsystem>();
+	if (LaserSubsystem)
+	{
+		LaserSubsystem->RegisterMirrorMaterial(MI_Mirror);
+		LaserSubsystem->RegisterGenerator(this);
+	}
 }
 
-// Called every frame
-void ALaserGenerator::Tick(float DeltaTime)
+void ALaserGenerator::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
-
-	ResetLaser();
+	Super::EndPlay(EndPlayReason);
 
-	FVector Start = Muzzle->GetComponentLocation();
-	FVector Direction = Muzzle->GetForwardVector();
-	Laser(Start, Direction * 10000, ReflectionCount);
+	ULaserSubsystem* LaserSubsystem = GetWorld()->GetSubsystem<ULaserSubsystem>();
+	if (LaserSubsystem)
+		LaserSubsystem->UnregisterGenerator(this);
 
-	CompareLaserCube();
-	CompareLaserTrigger();
-	DrawLaser();
+	Muzzle->TransformUpdated.RemoveAll(this);
+	UnwatchTracedComponents();
 }
 
-void ALaserGenerator::Laser(FVector Start, FVector Direction, int32 _ReflectionCount)
+bool ALaserGenerator::NeedsTrace()
 {
-	UWorld* World = GetWorld();
+	CheckStaleRays();
 
-	{
-		if (World == nullptr) return;
+	// Nothing the beam depends on has changed, the cached path and the trigger states are still right
+	return DirtyRayIndex != INDEX_NONE;
+}
 
-		if (MI_Mirror == nullptr) return;
+void ALaserGenerator::PrepareTrace(int32 FrameSegmentBudget)
+{
+	int32 FromRay = DirtyRayIndex;
+	DirtyRayIndex = INDEX_NONE;
 
-		if (MI_Glass == nullptr) return;
+	PendingTrace.Seeds.Reset();
 
-		if (Ptl_Laser == nullptr) return;
+	if (FromRay > 0 && Path.Rays.IsValidIndex(FromRay))
+	{
+		const FLaserRay& Ray = Path.Rays[FromRay];
+		PendingTrace.Seeds.Add({ Ray.Start, Ray.Direction, Ray.ReflectionCount, Ray.Parent });
+	}
+	else
+	{
+		FromRay = 0;
+		PendingTrace.Seeds.Add({ Muzzle->GetComponentLocation(), Muzzle->GetForwardVector() * 10000, ReflectionCount, INDEX_NONE });
 	}
 
-	FHitResult HitResult;
-	FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, true, this);
-	bool Result = World->LineTraceSingleByChannel(HitResult, Start, Start + Direction, ECollisionChannel::ECC_GameTraceChannel7, QueryParam);
+	ULaserSubsystem* LaserSubsystem = GetWorld()->GetSubsystem<ULaserSubsystem>();
 
+	PendingTrace.Settings.IgnoreActor = this;
+	PendingTrace.Settings.Responses = LaserSubsystem ? &LaserSubsystem->GetResponseTable() : nullptr;
+	PendingTrace.Settings.BVH = LaserSubsystem ? LaserSubsystem->GetLaserBVH() : nullptr;
+	PendingTrace.Settings.SegmentBudget = SegmentBudget;
+	PendingTrace.Settings.FrameSegmentBudget = FrameSegmentBudget;
+	PendingTrace.bValid = Ptl_Laser != nullptr;
+	PendingTrace.TracedSegments = 0;
+	PendingTrace.TracedRays = 0;
 
-	AActor* HitActor = HitResult.GetActor();
-	eHitType HitType;
+	PreviousPath = Path;
+	Path.Truncate(FromRay, &PendingTrace.Seeds);
+	LastTraceTime = GetWorld()->GetTimeSeconds();
+}
 
-	{
-		if (Result == false)
-		{
-			HitType = eHitType::NONE;
-			goto SWITCH;
-		}
+void ALaserGenerator::TraceLaser()
+{
+	if (PendingTrace.bValid == false) return;
 
-		if (Cast<APortal>(HitActor))
-		{
-			HitType = eHitType::PORTAL;
-			goto SET_LASER;
-		}
+	const int32 FirstRay = Path.Rays.Num();
+	PendingTrace.TracedSegments = FLaserTracer::Trace(GetWorld(), PendingTrace.Settings, PendingTrace.Seeds, Path);
+	PendingTrace.TracedRays = (Path.FirstPendingRay != INDEX_NONE ? Path.FirstPendingRay : Path.Rays.Num()) - FirstRay;
 
-		if (HitResult.GetComponent()->GetMaterial(0) == MI_Mirror)
-		{
-			HitType = eHitType::MIRROR;
-			goto SET_LASER;
-		}
+	// Branches left for next frame keep their beams and hits until then, a trigger behind them must not blink
+	Path.CarryPending(PreviousPath);
+}
 
-		if (SetLaserTrigger(Cast<ALaserTrigger>(HitActor)))
-		{
-			HitType = eHitType::TRIGGER;
-			goto SET_LASER;
-		}
+void ALaserGenerator::ApplyTrace()
+{
+	ULaserSubsystem* LaserSubsystem = GetWorld()->GetSubsystem<ULaserSubsystem>();
+	if (LaserSubsystem)
+		LaserSubsystem->MarkHitsDirty();
 
-		if (HitResult.GetComponent()->GetMaterial(0) == MI_Glass && AddLaserCube(Cast<ALaserCube>(HitActor)))
-		{
-			HitType = eHitType::LASER_CUBE;
-			goto SET_LASER;
-		}
+	DrawLaser();
 
-		// ߰ҰŴ ⿡ ߰
+	UnwatchTracedComponents();
+	WatchTracedComponents();
 
+	// Out of segments for this frame, carry on from the first branch that did not get any
+	MarkDirty(Path.FirstPendingRay);
+}
 
-		//    
-		HitType = eHitType::OTHER;
-		goto SET_LASER;
+void ALaserGenerator::GatherHits(FLaserHitRegistry& Registry) const
+{
+	for (const FLaserRay& Ray : Path.Rays)
+	{
+		if (Ray.HitType == ELaserHitType::TRIGGER || Ray.HitType == ELaserHitType::LASER_CUBE)
+			Registry.AddHit(Ray.HitActor.Get());
 	}
+}
 
-SET_LASER:
-	LaserParticles.Add(UGameplayStatics::SpawnEmitterAttached(Ptl_Laser, Muzzle));
-	SourcePoints.Add(Start);
-	EndPoints.Add(HitResult.ImpactPoint);
-
-SWITCH:
-	switch (HitType)
-	{
-	case eHitType::NONE:
-		LaserParticles.Add(UGameplayStatics::SpawnEmitterAttached(Ptl_Laser, Muzzle));
-		SourcePoints.Add(Start);
-		EndPoints.Add(Start + Direction);
-		break;
-	case eHitType::PORTAL:
+bool ALaserGenerator::IsLaserRelevant(const TArray<FLaserView>& Views, float RelevantDistance) const
+{
+	const FVector Location = GetActorLocation();
+	for (const FLaserView& View : Views)
 	{
-		APortal* Portal = Cast<APortal>(HitActor);
-		if (Portal->LinkedPortal.IsValid())
-		{
-			FVector RelativeStartPoint = Portal->Arrow->GetComponentTransform().InverseTransformPosition(HitResult.ImpactPoint);
-			Start = Portal->LinkedPortal->GetTransform().TransformPosition(RelativeStartPoint);
-
-			FVector RelativeDirection = Portal->Arrow->GetComponentTransform().InverseTransformVector(Direction);
-			Direction = Portal->LinkedPortal->GetTransform().TransformVector(RelativeDirection);
+		if (FVector::DistSquared(Location, View.Location) > FMath::Square(RelevantDistance)) continue;
 
-			Laser(Start, Direction, _ReflectionCount);
+		// Only views drawn on this machine know what was rendered, the others are judged by their frustum
+		if (View.bUseFrustum == false)
+		{
+			if (WasRecentlyRendered(0.2f))
+				return true;
+			continue;
 		}
-		break;
+
+		FVector Origin;
+		FVector Extent;
+		GetActorBounds(false, Origin, Extent);
+		if (View.Frustum.IntersectBox(Origin, Extent))
+			return true;
 	}
-	case eHitType::MIRROR:
-	{
-		if (_ReflectionCount == 0) return;
+	return false;
+}
 
-		FVector ImpactNormal = HitResult.ImpactNormal;
+void ALaserGenerator::Laser(FVector Start, FVector Direction, int32 _ReflectionCount)
+{
+	if (HasAuthority() == false) return;
 
-		Start = HitResult.ImpactPoint;
-		Direction = 2 * ImpactNormal * FVector::DotProduct(ImpactNormal, -1.f * Direction) + Direction;
+	PrepareTrace();
+	Path.Truncate(0);
+	PendingTrace.Seeds.Reset();
+	PendingTrace.Seeds.Add({ Start, Direction, _ReflectionCount, INDEX_NONE });
 
-		_ReflectionCount--;
-		Laser(Start, Direction, _ReflectionCount);
-		break;
-	}
-	case eHitType::TRIGGER:
-		break;
-	case eHitType::LASER_CUBE:
-	{
-		LaserParticles.Add(UGameplayStatics::SpawnEmitterAttached(Ptl_Laser, Muzzle));
-		SourcePoints.Add(HitResult.ImpactPoint);
-		EndPoints.Add(HitActor->GetActorLocation());
-
-		LaserParticles.Add(UGameplayStatics::SpawnEmitterAttached(Ptl_Laser, Muzzle));
-		SourcePoints.Add(HitActor->GetActorLocation());
-		EndPoints.Add(HitActor->GetActorLocation() + HitActor->GetActorForwardVector() * 50.f);
-
-		Start = HitActor->GetActorLocation() + HitActor->GetActorForwardVector() * 50.f;
-		Direction = HitActor->GetActorForwardVector() * 10000.f;
-		Laser(Start, Direction, _ReflectionCount);
-		break;
-	}
-	case eHitType::OTHER:
-		break;
-	default:
-		
-		break;
-	}
+	TraceLaser();
+	ApplyTrace();
 }
 
-bool ALaserGenerator::SetLaserTrigger(ALaserTrigger* laserTrigger)
+void ALaserGenerator::DrawLaser()
 {
-	if (laserTrigger == nullptr) return false;
+	BeamRenderer->DrawBeam(Path);
 
-	if (laserTrigger->GetIsLaserTriggerOn() == false)
-		laserTrigger->LaserTriggerOn();
-	CurrentLaserTrigger = laserTrigger;
-	return true;
+	if (HasAuthority())
+		BeamSegments.SetSegments(Path);
 }
 
-void ALaserGenerator::CompareLaserTrigger()
+void ALaserGenerator::OnRep_BeamSegments()
 {
-	if (CurrentLaserTrigger != PreviousLaserTrigger && PreviousLaserTrigger.IsValid())
-		PreviousLaserTrigger->LaserTriggerOff();
+	BeamSegments.GetSegments(Path);
+	BeamRenderer->DrawBeam(Path);
+}
+
+void ALaserGenerator::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	PreviousLaserTrigger = CurrentLaserTrigger;
-	CurrentLaserTrigger.Reset();
+	DOREPLIFETIME(ALaserGenerator, BeamSegments);
 }
 
-void ALaserGenerator::DrawLaser()
+void ALaserGenerator::MarkDirty(int32 RayIndex)
 {
-	if ((LaserParticles.Num() == SourcePoints.Num() && SourcePoints.Num() == EndPoints.Num()) == false) return;
+	if (RayIndex == INDEX_NONE) return;
+
+	if (DirtyRayIndex == INDEX_NONE || RayIndex < DirtyRayIndex)
+		DirtyRayIndex = RayIndex;
+}
 
-	for (int32 i = 0; i < LaserParticles.Num(); ++i)
+void ALaserGenerator::CheckStaleRays()
+{
+	for (int32 i = 0; i < Path.Rays.Num(); ++i)
 	{
-		LaserParticles[i]->SetBeamSourcePoint(0, SourcePoints[i], 0);
-		LaserParticles[i]->SetBeamEndPoint(0, EndPoints[i]);
-		LaserParticles[i]->SetRelativeScale3D(FVector(5.f, 5.f, 0.f));
+		if (Path.Rays[i].HitComponent.IsStale() || Path.Rays[i].LinkedComponent.IsStale())
+		{
+			MarkDirty(i);
+			return;
+		}
 	}
 }
 
-void ALaserGenerator::ResetLaser()
+void ALaserGenerator::InvalidateBounds(const UPrimitiveComponent* Component, const FBox& Bounds)
 {
-	for (auto LaserParticle : LaserParticles)
+	MarkDirty(Path.FindRayTouching(Component));
+
+	// Segments are stored in ray order, the first one crossing the bounds is the earliest ray affected
+	for (int32 i = 0; i < Path.Segments.Num(); ++i)
 	{
-		LaserParticle->DestroyComponent();
+		const FLaserSegment& Segment = Path.Segments[i];
+		if (FMath::LineBoxIntersection(Bounds, Segment.Start, Segment.End, Segment.End - Segment.Start))
+		{
+			MarkDirty(Path.FindRayOfSegment(i));
+			return;
+		}
 	}
-	LaserParticles.Empty();
-	SourcePoints.Empty();
-	EndPoints.Empty();
 }
 
-bool ALaserGenerator::AddLaserCube(ALaserCube* reflectionCube)
+void ALaserGenerator::WatchTracedComponents()
 {
-	if (reflectionCube == nullptr) return false;
+	auto WatchComponent = [this](TWeakObjectPtr<USceneComponent> Component)
+	{
+		if (Component.IsValid() == false || WatchedComponents.Contains(Component)) return;
+
+		Component->TransformUpdated.AddUObject(this, &ALaserGenerator::OnWatchedComponentMoved);
+
+		UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component.Get());
+		if (Primitive)
+			Primitive->OnComponentWake.AddUniqueDynamic(this, &ALaserGenerator::OnWatchedComponentWake);
 
-	for (TWeakObjectPtr<ALaserCube> ReflectionCube : CurrentReflectionCubes)
+		APortal* Portal = Cast<APortal>(Component->GetOwner());
+		if (Portal && WatchedPortals.Contains(Portal) == false)
+		{
+			Portal->OnPortalLinkChanged.AddUObject(this, &ALaserGenerator::OnWatchedPortalLinkChanged);
+			WatchedPortals.Add(Portal);
+		}
+
+		WatchedComponents.Add(Component);
+	};
+
+	for (const FLaserRay& LaserRay : Path.Rays)
+	{
+		WatchComponent(LaserRay.HitComponent);
+		WatchComponent(LaserRay.LinkedComponent);
+	}
+}
+
+void ALaserGenerator::UnwatchTracedComponents()
+{
+	for (TWeakObjectPtr<USceneComponent> Component : WatchedComponents)
+	{
+		if (Component.IsValid() == false) continue;
+
+		Component->TransformUpdated.RemoveAll(this);
+
+		UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(Component.Get());
+		if (Primitive)
+			Primitive->OnComponentWake.RemoveDynamic(this, &ALaserGenerator::OnWatchedComponentWake);
+	}
+	WatchedComponents.Reset();
+
+	for (TWeakObjectPtr<APortal> Portal : WatchedPortals)
 	{
-		if (reflectionCube == ReflectionCube)
-			return false;
+		if (Portal.IsValid())
+			Portal->OnPortalLinkChanged.RemoveAll(this);
 	}
+	WatchedPortals.Reset();
+}
+
+void ALaserGenerator::OnWatchedComponentMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	MarkDirty(Path.FindRayTouching(UpdatedComponent));
+}
 
-	if (reflectionCube->GetIsCoreOn() == false)
-		reflectionCube->CoreOn();
-	CurrentReflectionCubes.Add(reflectionCube);
-	return true;
+void ALaserGenerator::OnMuzzleMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	MarkDirty(0);
 }
 
-void ALaserGenerator::CompareLaserCube()
+void ALaserGenerator::OnWatchedPortalLinkChanged(APortal* Portal)
 {
-	for (TWeakObjectPtr<ALaserCube> PreviousReflectionCube : PreviousReflectionCubes)
+	for (int32 i = 0; i < Path.Rays.Num(); ++i)
 	{
-		bool IsContinuously = false;
-		for (TWeakObjectPtr<ALaserCube> CurrentReflectionCube : CurrentReflectionCubes)
+		if (Path.Rays[i].HitActor == Portal)
 		{
-			if (PreviousReflectionCube == CurrentReflectionCube)
-			{
-				IsContinuously = true;
-				break;
-			}
+			MarkDirty(i);
+			return;
+		}
+		if (Path.Rays[i].LinkedComponent.IsValid() && Path.Rays[i].LinkedComponent->GetOwner() == Portal)
+		{
+			MarkDirty(i);
+			return;
 		}
-
-		if (IsContinuously == false)
-			PreviousReflectionCube->CoreOff();
 	}
+}
 
-	PreviousReflectionCubes.Empty();
-	for (TWeakObjectPtr<ALaserCube> CurrentReflectionCube : CurrentReflectionCubes)
-		PreviousReflectionCubes.Add(CurrentReflectionCube);
-	CurrentReflectionCubes.Empty();
+void ALaserGenerator::OnWatchedComponentWake(UPrimitiveComponent* WakingComponent, FName BoneName)
+{
+	MarkDirty(Path.FindRayTouching(WakingComponent));
 }
@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "LaserPath.h"
+#include "LaserTracer.h"
+#include "LaserNetPath.h"
 #include "LaserGenerator.generated.h"
 
 UCLASS()
@@ -19,9 +22,32 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+
+	// Re-trace from the first segment touching Component or crossing Bounds
+	void InvalidateBounds(const UPrimitiveComponent* Component, const FBox& Bounds);
+
+	// Driven by ULaserSubsystem: NeedsTrace, PrepareTrace and ApplyTrace on the game thread, TraceLaser on any thread
+	bool NeedsTrace();
+	void PrepareTrace(int32 FrameSegmentBudget = MAX_int32);
+	void TraceLaser();
+	void ApplyTrace();
+
+	// Segments and line traces of the last TraceLaser
+	int32 GetTracedSegmentNum() const { return PendingTrace.TracedSegments; }
+	int32 GetTracedRayNum() const { return PendingTrace.TracedRays; }
+
+	// Close to one of Views and seen from it
+	bool IsLaserRelevant(const TArray<struct FLaserView>& Views, float RelevantDistance) const;
+
+	double GetLastTraceTime() const { return LastTraceTime; }
+
+	// Every trigger and cube the current path lights
+	void GatherHits(class FLaserHitRegistry& Registry) const;
 
 private:
 
@@ -37,41 +63,58 @@ private:
 	UFUNCTION(BlueprintCallable, meta = (AllowPrivateAccess = "true"))
 	void Laser(FVector Start, FVector Direction, int32 _ReflectionCount);
 
-	TArray<class UParticleSystemComponent*> LaserParticles;
-	TArray<FVector>SourcePoints;
-	TArray<FVector>EndPoints;
+	UPROPERTY(VisibleAnywhere)
+	class ULaserBeamRenderer* BeamRenderer;
+
+	// Last traced beam, kept so it can be re-traced from the ray whose inputs changed
+	FLaserPath Path;
+
+	// Path before the last PrepareTrace, pending rays are filled from it
+	FLaserPath PreviousPath;
+	int32 DirtyRayIndex;
+	double LastTraceTime;
 	void DrawLaser();
-	void ResetLaser();
+	void MarkDirty(int32 RayIndex);
+	void CheckStaleRays();
+
+	// Snapshot taken by PrepareTrace so TraceLaser never touches anything but Path
+	struct FPendingTrace
+	{
+		FLaserTraceSettings Settings;
+		TArray<FLaserBeamSeed, TInlineAllocator<8>> Seeds;
+		int32 TracedSegments;
+		int32 TracedRays;
+		bool bValid;
+	};
+	FPendingTrace PendingTrace;
+
+	// The server traces, clients only draw what it sends
+	UPROPERTY(ReplicatedUsing = OnRep_BeamSegments)
+	FLaserNetPath BeamSegments;
+
+	UFUNCTION()
+	void OnRep_BeamSegments();
+
+	TArray<TWeakObjectPtr<USceneComponent>> WatchedComponents;
+	TArray<TWeakObjectPtr<class APortal>> WatchedPortals;
+	void WatchTracedComponents();
+	void UnwatchTracedComponents();
+	void OnWatchedComponentMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	void OnMuzzleMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	void OnWatchedPortalLinkChanged(class APortal* Portal);
+	UFUNCTION()
+	void OnWatchedComponentWake(UPrimitiveComponent* WakingComponent, FName BoneName);
+
 	UPROPERTY(EditDefaultsOnly)
 	int32 ReflectionCount;
 
+	// Most segments one beam tree may use, portal and cube loops stop here at the latest
+	UPROPERTY(EditDefaultsOnly, meta = (ClampMin = "1", ClampMax = "48"))
+	int32 SegmentBudget;
+
+	// Meshes that are not ILaserInteractable reflect when they use this material or an instance of it
 	UPROPERTY(EditDefaultsOnly)
 	class UMaterialInterface* MI_Mirror;
 	UPROPERTY(EditDefaultsOnly)
-	class UMaterialInterface* MI_Glass;
-	UPROPERTY(EditDefaultsOnly)
 	class UParticleSystem* Ptl_Laser;
-
-	UPROPERTY(VisibleInstanceOnly)
-	TWeakObjectPtr<class ALaserTrigger> CurrentLaserTrigger;
-	UPROPERTY(VisibleInstanceOnly)
-	TWeakObjectPtr<class ALaserTrigger> PreviousLaserTrigger;
-	bool SetLaserTrigger(class ALaserTrigger* laserTrigger);
-	void CompareLaserTrigger();
-
-	TArray<TWeakObjectPtr<class ALaserCube>> CurrentReflectionCubes;
-	TArray<TWeakObjectPtr<class ALaserCube>> PreviousReflectionCubes;
-	bool AddLaserCube(class ALaserCube* reflectionCube);
-	void CompareLaserCube();
-
-	enum class eHitType
-	{
-		NONE,
-		PORTAL,
-		MIRROR,
-		TRIGGER,
-		LASER_CUBE,
-
-		OTHER
-	};
 };
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserHitRegistry.h"
+#include "LaserInteractable.h"
+
+void FLaserHitRegistry::BeginFrame()
+{
+	++Generation;
+	CurrentHits.Reset();
+}
+
+void FLaserHitRegistry::AddHit(AActor* Target)
+{
+	if (Target == nullptr) return;
+
+	FLaserHitEntry& Entry = Entries.FindOrAdd(Target);
+	if (Entry.Generation != Generation)
+	{
+		// First hit this frame, a target already lit keeps its old entry and only gets a new stamp
+		const bool bWasLit = Entry.Generation == Generation - 1 && Entry.HitCount > 0;
+
+		Entry.Target = Target;
+		Entry.HitCount = 0;
+		Entry.Generation = Generation;
+		CurrentHits.Add(Target);
+
+		if (bWasLit == false)
+			SetTargetLit(Target, true);
+	}
+	++Entry.HitCount;
+}
+
+void FLaserHitRegistry::EndFrame()
+{
+	// Anything hit last frame without a new stamp lost its last beam
+	for (const TObjectKey<AActor>& Key : PreviousHits)
+	{
+		FLaserHitEntry* Entry = Entries.Find(Key);
+		if (Entry == nullptr || Entry->Generation == Generation) continue;
+
+		if (Entry->Target.IsValid())
+			SetTargetLit(Entry->Target.Get(), false);
+		Entries.Remove(Key);
+	}
+
+	Swap(PreviousHits, CurrentHits);
+	CurrentHits.Reset();
+}
+
+void FLaserHitRegistry::Reset()
+{
+	Entries.Reset();
+	CurrentHits.Reset();
+	PreviousHits.Reset();
+}
+
+int32 FLaserHitRegistry::GetHitCount(const AActor* Target) const
+{
+	const FLaserHitEntry* Entry = Entries.Find(Target);
+	return Entry && Entry->Generation == Generation ? Entry->HitCount : 0;
+}
+
+void FLaserHitRegistry::SetTargetLit(AActor* Target, bool bLit)
+{
+	ILaserInteractable* Interactable = Cast<ILaserInteractable>(Target);
+	if (Interactable)
+		Interactable->SetLaserLit(bLit);
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+/**
+ * Counts how many laser paths hit each trigger and cube. All generators
+ * submit their hits between BeginFrame and EndFrame, and a target is only
+ * switched on or off when its count goes from 0 to 1 or from 1 to 0. That
+ * way two beams on one trigger no longer switch each other off.
+ * Entries are stamped with the generation that last hit them, so a frame
+ * costs O(hits) and never walks targets nobody hits.
+ */
+class TPS_API FLaserHitRegistry
+{
+public:
+
+	void BeginFrame();
+	void AddHit(AActor* Target);
+	void EndFrame();
+
+	// Forgets every hit without switching anything, for when the world goes away
+	void Reset();
+
+	int32 GetHitCount(const AActor* Target) const;
+
+private:
+
+	struct FLaserHitEntry
+	{
+		TWeakObjectPtr<AActor> Target;
+		int32 HitCount = 0;
+		uint32 Generation = 0;
+	};
+
+	static void SetTargetLit(AActor* Target, bool bLit);
+
+	TMap<TObjectKey<AActor>, FLaserHitEntry> Entries;
+
+	// Targets hit in the current and in the last finished frame
+	TArray<TObjectKey<AActor>> CurrentHits;
+	TArray<TObjectKey<AActor>> PreviousHits;
+
+	uint32 Generation = 0;
+};
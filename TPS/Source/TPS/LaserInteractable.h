@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "UObject/ObjectKey.h"
+#include "LaserInteractable.generated.h"
+
+// What the beam does when it hits a component
+enum class ELaserResponse : uint8
+{
+	NONE,
+	REFLECT,
+	PORTAL,
+	ABSORB,
+	REDIRECT,
+	TRIGGER
+};
+
+// Where a PORTAL or REDIRECT sends the beam next, a splitter has more than one
+struct FLaserExit
+{
+	FVector Start;
+	FVector Direction;
+
+	// Drawn as impact -> Through -> Start, a portal jumps straight to Start
+	bool bDrawThrough = false;
+	FVector Through;
+
+	TWeakObjectPtr<USceneComponent> LinkedComponent;
+};
+
+typedef TArray<FLaserExit, TInlineAllocator<2>> FLaserExits;
+
+UINTERFACE(MinimalAPI)
+class ULaserInteractable : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Actors the laser does more with than stop at. The response of each
+ * primitive is asked once when it registers and cached by ULaserSubsystem,
+ * so the tracer never has to cast or look at materials per hit.
+ */
+class TPS_API ILaserInteractable
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual ELaserResponse GetLaserResponse(const UPrimitiveComponent* Component) const = 0;
+
+	// PORTAL and REDIRECT only, every exit becomes a child beam and none stops the beam at the impact point. May run off the game thread
+	virtual void GetLaserExits(const FHitResult& HitResult, const FVector& Direction, FLaserExits& OutExits) const {}
+
+	// TRIGGER and REDIRECT, called when the first beam arrives and when the last one leaves
+	virtual void SetLaserLit(bool bLit) {}
+};
+
+struct FLaserResponseEntry
+{
+	ELaserResponse Response;
+	ILaserInteractable* Interactable;
+};
+
+// Only components with a response are in here, everything else absorbs
+typedef TMap<TObjectKey<UPrimitiveComponent>, FLaserResponseEntry> FLaserResponseTable;
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserNetPath.h"
+
+void FLaserNetPath::SetSegments(const FLaserPath& Path)
+{
+	// What survives quantization, anything below that would only send the same bits again
+	auto IsSamePoint = [](const FVector& A, const FVector& B)
+	{
+		return A.Equals(B, 0.5f);
+	};
+
+	const int32 NumSegments = Path.Segments.Num();
+	if (Segments.Num() > NumSegments)
+	{
+		Segments.SetNum(NumSegments);
+		MarkArrayDirty();
+	}
+
+	for (int32 i = 0; i < NumSegments; ++i)
+	{
+		const FLaserSegment& Segment = Path.Segments[i];
+
+		if (Segments.IsValidIndex(i) == false)
+			Segments.AddDefaulted();
+		else if (IsSamePoint(Segments[i].Start, Segment.Start) && IsSamePoint(Segments[i].End, Segment.End))
+			continue;
+
+		Segments[i].Start = Segment.Start;
+		Segments[i].End = Segment.End;
+		MarkItemDirty(Segments[i]);
+	}
+}
+
+void FLaserNetPath::GetSegments(FLaserPath& OutPath) const
+{
+	OutPath.Segments.Reset();
+
+	for (const FLaserNetSegment& Segment : Segments)
+	{
+		if (OutPath.Segments.Num() >= FLaserPath::MaxSegments) break;
+
+		OutPath.Segments.Add({ Segment.Start, Segment.End });
+	}
+}
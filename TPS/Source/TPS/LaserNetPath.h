@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "LaserPath.h"
+#include "LaserNetPath.generated.h"
+
+USTRUCT()
+struct FLaserNetSegment : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Start;
+
+	UPROPERTY()
+	FVector_NetQuantize End;
+};
+
+/**
+ * Beam segments as the server traced them. Endpoints are quantized to whole
+ * units and the fast array only sends segments that changed since what each
+ * client acknowledged, so re-tracing the tail of a beam sends only the tail.
+ * Clients draw from this and never trace themselves.
+ */
+USTRUCT()
+struct FLaserNetPath : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	// Server side, dirties only the segments that moved by a unit or more
+	void SetSegments(const FLaserPath& Path);
+
+	// Client side, segment order is not kept but the beam renderer does not need it
+	void GetSegments(FLaserPath& OutPath) const;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FLaserNetSegment, FLaserNetPath>(Segments, DeltaParms, *this);
+	}
+
+private:
+
+	UPROPERTY()
+	TArray<FLaserNetSegment> Segments;
+};
+
+template<>
+struct TStructOpsTypeTraits<FLaserNetPath> : public TStructOpsTypeTraitsBase2<FLaserNetPath>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserPath.h"
+
+void FLaserPath::Truncate(int32 FromRay, TArray<FLaserBeamSeed, TInlineAllocator<8>>* OutSeeds)
+{
+	FromRay = FMath::Clamp(FromRay, 0, Rays.Num());
+	if (FromRay < Rays.Num())
+	{
+		// Siblings queued after FromRay were started by rays that stay, keep their inputs
+		if (OutSeeds)
+		{
+			for (int32 i = FromRay + 1; i < Rays.Num(); ++i)
+			{
+				if (Rays[i].Parent < FromRay)
+					OutSeeds->Add({ Rays[i].Start, Rays[i].Direction, Rays[i].ReflectionCount, Rays[i].Parent });
+			}
+		}
+
+		Segments.SetNum(Rays[FromRay].FirstSegment, false);
+		Rays.SetNum(FromRay, false);
+	}
+
+	bTruncated = false;
+	FirstPendingRay = INDEX_NONE;
+}
+
+void FLaserPath::CarryPending(const FLaserPath& Previous)
+{
+	if (FirstPendingRay == INDEX_NONE) return;
+
+	// Ray of this path each ray of Previous was carried to
+	TArray<int32, TFixedAllocator<MaxRays>> CarriedTo;
+	CarriedTo.Init(INDEX_NONE, Previous.Rays.Num());
+
+	// Pending rays are queued last and have no segments yet, so their own come first and in order
+	bool bFits = true;
+	for (int32 i = FirstPendingRay; i < Rays.Num(); ++i)
+	{
+		FLaserRay& Ray = Rays[i];
+		Ray.FirstSegment = Segments.Num();
+		if (bFits == false) continue;
+
+		const int32 Match = Previous.Rays.IndexOfByPredicate([&Ray](const FLaserRay& PreviousRay)
+		{
+			return PreviousRay.ReflectionCount == Ray.ReflectionCount
+				&& PreviousRay.Start.Equals(Ray.Start, 1.f)
+				&& PreviousRay.Direction.GetSafeNormal().Equals(Ray.Direction.GetSafeNormal(), 0.001f);
+		});
+		if (Match == INDEX_NONE || CarriedTo[Match] != INDEX_NONE) continue;
+
+		bFits = CopySegments(Previous, Match);
+		if (bFits == false) continue;
+
+		const FLaserRay& PreviousRay = Previous.Rays[Match];
+		Ray.HitType = PreviousRay.HitType;
+		Ray.HitActor = PreviousRay.HitActor;
+		Ray.HitComponent = PreviousRay.HitComponent;
+		Ray.LinkedComponent = PreviousRay.LinkedComponent;
+		Ray.EntryDirection = PreviousRay.EntryDirection;
+		CarriedTo[Match] = i;
+	}
+	if (bFits == false) return;
+
+	// Then the subtrees below them, Previous is breadth first so every parent is carried before its children
+	for (int32 i = 0; i < Previous.Rays.Num(); ++i)
+	{
+		const int32 Parent = Previous.Rays[i].Parent;
+		if (CarriedTo[i] != INDEX_NONE || Parent == INDEX_NONE || CarriedTo[Parent] == INDEX_NONE) continue;
+		if (Rays.Num() >= MaxRays) return;
+
+		const int32 FirstCarriedSegment = Segments.Num();
+		if (CopySegments(Previous, i) == false) return;
+
+		FLaserRay& Ray = Rays.Add_GetRef(Previous.Rays[i]);
+		Ray.Parent = CarriedTo[Parent];
+		Ray.FirstSegment = FirstCarriedSegment;
+		Ray.bPending = true;
+		CarriedTo[i] = Rays.Num() - 1;
+	}
+}
+
+bool FLaserPath::CopySegments(const FLaserPath& Previous, int32 PreviousRay)
+{
+	const int32 First = Previous.Rays[PreviousRay].FirstSegment;
+	const int32 Last = Previous.Rays.IsValidIndex(PreviousRay + 1) ? Previous.Rays[PreviousRay + 1].FirstSegment : Previous.Segments.Num();
+	if (Segments.Num() + Last - First > MaxSegments) return false;
+
+	for (int32 i = First; i < Last; ++i)
+		Segments.Add(Previous.Segments[i]);
+	return true;
+}
+
+bool FLaserPath::IsAncestor(int32 Ancestor, int32 RayIndex) const
+{
+	while (Rays.IsValidIndex(RayIndex))
+	{
+		if (RayIndex == Ancestor)
+			return true;
+		RayIndex = Rays[RayIndex].Parent;
+	}
+	return false;
+}
+
+bool FLaserPath::HasRedirected(const AActor* Actor) const
+{
+	for (const FLaserRay& Ray : Rays)
+	{
+		if (Ray.HitType == ELaserHitType::LASER_CUBE && Ray.HitActor == Actor)
+			return true;
+	}
+	return false;
+}
+
+int32 FLaserPath::FindRayOfSegment(int32 SegmentIndex) const
+{
+	for (int32 i = Rays.Num() - 1; i >= 0; --i)
+	{
+		if (Rays[i].FirstSegment <= SegmentIndex)
+			return i;
+	}
+	return 0;
+}
+
+int32 FLaserPath::FindRayTouching(const USceneComponent* Component) const
+{
+	if (Component == nullptr) return INDEX_NONE;
+
+	for (int32 i = 0; i < Rays.Num(); ++i)
+	{
+		if (Rays[i].HitComponent == Component || Rays[i].LinkedComponent == Component)
+			return i;
+	}
+	return INDEX_NONE;
+}
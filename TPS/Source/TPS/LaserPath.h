@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ELaserHitType : uint8
+{
+	NONE,
+	PORTAL,
+	MIRROR,
+	TRIGGER,
+	LASER_CUBE,
+
+	OTHER
+};
+
+struct FLaserSegment
+{
+	FVector Start;
+	FVector End;
+};
+
+// Where a ray starts, the inputs the tracer needs to trace it again
+struct FLaserBeamSeed
+{
+	FVector Start;
+	FVector Direction;
+	int32 ReflectionCount;
+	int32 Parent;
+};
+
+// One line trace of the beam. Start, Direction, ReflectionCount and Parent are its inputs, the rest is what it found
+struct FLaserRay
+{
+	FVector Start;
+	FVector Direction;
+	int32 ReflectionCount;
+
+	// Ray whose hit started this one, INDEX_NONE for the muzzle. Always lower than the ray's own index
+	int32 Parent;
+
+	int32 FirstSegment;
+
+	// Queued when the frame's segment budget ran out, not traced yet. Until it is, the ray
+	// and its subtree show what the previous path traced from the same inputs, if anything
+	bool bPending;
+
+	ELaserHitType HitType;
+	TWeakObjectPtr<AActor> HitActor;
+	TWeakObjectPtr<USceneComponent> HitComponent;
+	TWeakObjectPtr<USceneComponent> LinkedComponent;
+
+	// Quantized Direction, (HitActor, EntryDirection) identifies a ray for loop detection
+	FIntVector EntryDirection;
+};
+
+/**
+ * Output of FLaserTracer, a tree of rays in breadth first order with the
+ * segments of each ray stored in the same order. Fixed capacity so tracing
+ * never allocates, the beam renderer and the trigger / cube logic read from it.
+ */
+struct FLaserPath
+{
+	enum { MaxSegments = 48 };
+	enum { MaxRays = MaxSegments };
+
+	TArray<FLaserSegment, TFixedAllocator<MaxSegments>> Segments;
+	TArray<FLaserRay, TFixedAllocator<MaxRays>> Rays;
+
+	// The beam was cut short by the segment budget or a loop
+	bool bTruncated = false;
+
+	// First ray still waiting for segment budget, INDEX_NONE when the whole tree is traced
+	int32 FirstPendingRay = INDEX_NONE;
+
+	// Drops FromRay and everything traced after it. Rays after FromRay whose parent stays
+	// are added to OutSeeds so tracing them again restores the rest of the tree
+	void Truncate(int32 FromRay, TArray<FLaserBeamSeed, TInlineAllocator<8>>* OutSeeds = nullptr);
+
+	// Fills the pending rays with the hits, segments and subtrees Previous had for the same
+	// inputs, so a beam cut short by the budget does not lose what it reached last frame
+	void CarryPending(const FLaserPath& Previous);
+
+	bool IsAncestor(int32 Ancestor, int32 RayIndex) const;
+	bool HasRedirected(const AActor* Actor) const;
+
+	int32 FindRayOfSegment(int32 SegmentIndex) const;
+	int32 FindRayTouching(const USceneComponent* Component) const;
+
+private:
+
+	// Appends the segments of Previous's ray, false when they do not fit
+	bool CopySegments(const FLaserPath& Previous, int32 PreviousRay);
+};
@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserStressCommandlet.h"
+#include "Engine/World.h"
+#include "StandaloneGameWorld.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Portal.h"
+#include "LaserSubsystem.h"
+#include "PortalSubsystem.h"
+
+namespace
+{
+	const TCHAR* LaserGeneratorClassPath = TEXT("Class'/Game/Platforms/BP_LaserGenerator.BP_LaserGenerator_C'");
+	const TCHAR* MirrorCubeClassPath = TEXT("Class'/Game/Platforms/BP_MirrorCube.BP_MirrorCube_C'");
+	const TCHAR* LaserCubeClassPath = TEXT("Class'/Game/Platforms/BP_LaserCube.BP_LaserCube_C'");
+	const TCHAR* PortalClassPath = TEXT("Class'/Game/Portal/BP_Portal.BP_Portal_C'");
+
+	// Distance between lanes and between reflectors along a lane
+	const float LaneSpacing = 400.f;
+	const float ReflectorSpacing = 600.f;
+
+	// The stand-in view, behind the generators and above the lanes
+	const float StressViewBack = 500.f;
+	const float StressViewHeight = 300.f;
+	const float StressViewFOV = 90.f;
+}
+
+ULaserStressCommandlet::ULaserStressCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 ULaserStressCommandlet::Main(const FString& Params)
+{
+	int32 NumGenerators = 16;
+	int32 NumReflectors = 64;
+	int32 NumPortalPairs = 4;
+	int32 NumFrames = 600;
+	FString CsvPath = FPaths::ProjectSavedDir() / TEXT("LaserStress.csv");
+
+	FParse::Value(*Params, TEXT("Generators="), NumGenerators);
+	FParse::Value(*Params, TEXT("Reflectors="), NumReflectors);
+	FParse::Value(*Params, TEXT("Portals="), NumPortalPairs);
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	FParse::Value(*Params, TEXT("Csv="), CsvPath);
+	NumGenerators = FMath::Max(1, NumGenerators);
+
+	FStandaloneGameWorld GameWorld(TEXT("LaserStress"));
+	UWorld* World = GameWorld.Get();
+
+	const int32 ObjectsBeforeSpawn = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	SpawnStressMap(World, NumGenerators, NumReflectors, NumPortalPairs);
+	const int32 ObjectsAfterSpawn = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	UE_LOG(LogTemp, Display, TEXT("Laser stress map: %d generators, %d reflectors, %d portal pairs, %d objects spawned"),
+		NumGenerators, NumReflectors, NumPortalPairs, ObjectsAfterSpawn - ObjectsBeforeSpawn);
+
+	ULaserSubsystem* LaserSubsystem = World->GetSubsystem<ULaserSubsystem>();
+	UPortalSubsystem* PortalSubsystem = World->GetSubsystem<UPortalSubsystem>();
+
+	// No player looks at this world, a camera behind the generators down the lanes stands in so near beams and captures run
+	const FVector ViewLocation(-StressViewBack, (NumGenerators - 1) * LaneSpacing * 0.5f, StressViewHeight);
+	if (LaserSubsystem)
+		LaserSubsystem->SetViewOverride(ViewLocation, FRotator::ZeroRotator, StressViewFOV);
+	if (PortalSubsystem)
+		PortalSubsystem->SetViewOverride(ViewLocation, FRotator::ZeroRotator, StressViewFOV, FIntPoint(1920, 1080));
+
+	FString Csv = TEXT("Frame,FrameMs,LaserTraceMs,LaserApplyMs,PortalTransitMs,PortalCaptureMs,TracedGenerators,TracedRays,TracedSegments,PortalCaptures,PortalCapturesSkipped,NewObjects,UsedPhysicalKB\n");
+
+	const float DeltaSeconds = 1.f / 60.f;
+	int32 ObjectCount = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const double FrameStartTime = FPlatformTime::Seconds();
+
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+
+		const double FrameSeconds = FPlatformTime::Seconds() - FrameStartTime;
+
+		const FLaserTickStats LaserStats = LaserSubsystem ? LaserSubsystem->GetLastTickStats() : FLaserTickStats();
+		const FPortalCaptureStats CaptureStats = PortalSubsystem ? PortalSubsystem->GetLastCaptureStats() : FPortalCaptureStats();
+		const double TransitSeconds = PortalSubsystem ? PortalSubsystem->GetLastTransitSeconds() : 0.0;
+		const double CaptureSeconds = PortalSubsystem ? PortalSubsystem->GetLastCaptureSeconds() : 0.0;
+		const int32 NewObjectCount = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+		Csv += FString::Printf(TEXT("%d,%.4f,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%d,%d,%llu\n"),
+			Frame,
+			FrameSeconds * 1000.0,
+			LaserStats.TraceSeconds * 1000.0,
+			LaserStats.ApplySeconds * 1000.0,
+			TransitSeconds * 1000.0,
+			CaptureSeconds * 1000.0,
+			LaserStats.TracedGenerators,
+			LaserStats.TracedRays,
+			LaserStats.TracedSegments,
+			CaptureStats.Captured,
+			CaptureStats.GetSkipped(),
+			NewObjectCount - ObjectCount,
+			(uint64)(FPlatformMemory::GetStats().UsedPhysical / 1024));
+
+		ObjectCount = NewObjectCount;
+	}
+
+	FFileHelper::SaveStringToFile(Csv, *CsvPath);
+	UE_LOG(LogTemp, Display, TEXT("Laser stress results written to %s"), *CsvPath);
+
+	return 0;
+}
+
+void ULaserStressCommandlet::SpawnStressMap(UWorld* World, int32 NumGenerators, int32 NumReflectors, int32 NumPortalPairs)
+{
+	// One lane per generator along X, reflectors fill the lanes round robin
+	for (int32 i = 0; i < NumGenerators; ++i)
+		SpawnStressActor(World, LaserGeneratorClassPath, FTransform(FVector(0.f, i * LaneSpacing, 100.f)));
+
+	for (int32 i = 0; i < NumReflectors; ++i)
+	{
+		const int32 Lane = i % NumGenerators;
+		const FVector Location(ReflectorSpacing * (1 + i / NumGenerators), Lane * LaneSpacing, 100.f);
+
+		// Mirrors at 45 degrees throw beams across the other lanes, cubes pass them on
+		const bool bMirror = i % 2 == 0;
+		AActor* Reflector = SpawnStressActor(World, bMirror ? MirrorCubeClassPath : LaserCubeClassPath, FTransform(FRotator(0.f, bMirror ? 45.f : 0.f, 0.f), Location));
+
+		UPrimitiveComponent* Root = Reflector ? Cast<UPrimitiveComponent>(Reflector->GetRootComponent()) : nullptr;
+		if (Root)
+			Root->SetSimulatePhysics(false);
+	}
+
+	// Portal pairs behind the last reflectors, each sends its lane back towards the generators
+	const float PortalDistance = ReflectorSpacing * (2 + NumReflectors / NumGenerators);
+	for (int32 i = 0; i < NumPortalPairs; ++i)
+	{
+		const float LaneY = (i % NumGenerators) * LaneSpacing;
+		const FTransform TransformA(FRotator(0.f, 180.f, 0.f), FVector(PortalDistance, LaneY, 100.f));
+		const FTransform TransformB(FRotator(0.f, 0.f, 0.f), FVector(PortalDistance + ReflectorSpacing, LaneY + LaneSpacing * 0.5f, 100.f));
+
+		UClass* PortalClass = FStandaloneGameWorld::LoadClass(PortalClassPath);
+		if (PortalClass == nullptr) return;
+
+		APortal* PortalA = World->SpawnActorDeferred<APortal>(PortalClass, TransformA);
+		APortal* PortalB = World->SpawnActorDeferred<APortal>(PortalClass, TransformB);
+		if (PortalA == nullptr || PortalB == nullptr) continue;
+
+		PortalA->PortalA = true;
+		PortalB->PortalA = false;
+		PortalA->FinishSpawning(TransformA);
+		PortalB->FinishSpawning(TransformB);
+		PortalA->LinkPortal(PortalB);
+	}
+}
+
+AActor* ULaserStressCommandlet::SpawnStressActor(UWorld* World, const TCHAR* ClassPath, const FTransform& Transform)
+{
+	UClass* ActorClass = FStandaloneGameWorld::LoadClass(ClassPath);
+	if (ActorClass == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not load %s"), ClassPath);
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<AActor>(ActorClass, Transform, SpawnParameters);
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LaserStressCommandlet.generated.h"
+
+/**
+ * Builds a laser and portal stress map in an empty world, ticks it for a
+ * fixed number of frames and writes one CSV row per frame.
+ *
+ * UE4Editor-Cmd TPS.uproject -run=LaserStress -nullrhi
+ *     -Generators=16 -Reflectors=64 -Portals=4 -Frames=600 -Csv=Saved/LaserStress.csv
+ */
+UCLASS()
+class TPS_API ULaserStressCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	ULaserStressCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+
+	void SpawnStressMap(UWorld* World, int32 NumGenerators, int32 NumReflectors, int32 NumPortalPairs);
+
+	AActor* SpawnStressActor(UWorld* World, const TCHAR* ClassPath, const FTransform& Transform);
+};
@@ -0,0 +1,437 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserSubsystem.h"
+#include "EngineUtils.h"
+#include "LaserGenerator.h"
+#include "Async/ParallelFor.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "PortalCaptureScheduler.h"
+#include "Materials/MaterialInstance.h"
+
+DECLARE_CYCLE_STAT(TEXT("Laser Trace Near"), STAT_LaserTraceNear, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Laser Trace Far"), STAT_LaserTraceFar, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Laser Apply"), STAT_LaserApply, STATGROUP_Game);
+
+ULaserSubsystem::ULaserSubsystem()
+{
+	FarTraceBudgetMs = 0.5f;
+	RelevantDistance = 3000.0f;
+	bHitsDirty = false;
+	bUseLaserBVH = true;
+	SegmentBudgetPerFrame = 256;
+}
+
+void ULaserSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	ActorSpawnedHandle = GetWorld()->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &ULaserSubsystem::OnActorSpawned));
+}
+
+void ULaserSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	Generators.Empty();
+	HitRegistry.Reset();
+	Responses.Empty();
+	BVH.Reset();
+
+	Super::Deinitialize();
+}
+
+void ULaserSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	for (TActorIterator<AActor> It(&InWorld); It; ++It)
+		AddActor(*It);
+}
+
+void ULaserSubsystem::Tick(float DeltaTime)
+{
+	LastTickStats = FLaserTickStats();
+	const double TraceStartTime = FPlatformTime::Seconds();
+
+	TArray<FLaserView> Views;
+	GetViews(Views);
+
+	TArray<ALaserGenerator*> NearGenerators;
+	TArray<ALaserGenerator*> FarGenerators;
+	for (TWeakObjectPtr<ALaserGenerator> Generator : Generators)
+	{
+		if (Generator.IsValid() == false || Generator->NeedsTrace() == false) continue;
+
+		if (Generator->IsLaserRelevant(Views, RelevantDistance))
+			NearGenerators.Add(Generator.Get());
+		else
+			FarGenerators.Add(Generator.Get());
+	}
+
+	if (NearGenerators.Num() == 0 && FarGenerators.Num() == 0)
+	{
+		UpdateHits();
+		return;
+	}
+
+	TSet<ALaserGenerator*> TracedGenerators;
+	int32 RemainingSegments = SegmentBudgetPerFrame;
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_LaserTraceNear);
+
+		TraceBatch(NearGenerators, RemainingSegments);
+		TracedGenerators.Append(NearGenerators);
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_LaserTraceFar);
+
+		// The longest waiting beams first so none of them starves
+		FarGenerators.Sort([](const ALaserGenerator& A, const ALaserGenerator& B) { return A.GetLastTraceTime() < B.GetLastTraceTime(); });
+
+		const double Deadline = FPlatformTime::Seconds() + FarTraceBudgetMs * 0.001;
+		const int32 BatchSize = FMath::Max(1, FTaskGraphInterface::Get().GetNumWorkerThreads());
+
+		TArray<ALaserGenerator*> Batch;
+		for (int32 i = 0; i < FarGenerators.Num() && RemainingSegments > 0 && FPlatformTime::Seconds() < Deadline; i += BatchSize)
+		{
+			Batch.Reset();
+			for (int32 j = i; j < FMath::Min(i + BatchSize, FarGenerators.Num()); ++j)
+				Batch.Add(FarGenerators[j]);
+
+			TraceBatch(Batch, RemainingSegments);
+			TracedGenerators.Append(Batch);
+		}
+	}
+
+	const double ApplyStartTime = FPlatformTime::Seconds();
+	LastTickStats.TraceSeconds = ApplyStartTime - TraceStartTime;
+	LastTickStats.TracedGenerators = TracedGenerators.Num();
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_LaserApply);
+
+		for (TWeakObjectPtr<ALaserGenerator> Generator : Generators)
+		{
+			if (Generator.IsValid() == false || TracedGenerators.Contains(Generator.Get()) == false) continue;
+
+			LastTickStats.TracedRays += Generator->GetTracedRayNum();
+			LastTickStats.TracedSegments += Generator->GetTracedSegmentNum();
+			Generator->ApplyTrace();
+		}
+	}
+
+	UpdateHits();
+
+	LastTickStats.ApplySeconds = FPlatformTime::Seconds() - ApplyStartTime;
+}
+
+void ULaserSubsystem::UpdateHits()
+{
+	if (bHitsDirty == false) return;
+	bHitsDirty = false;
+
+	SCOPE_CYCLE_COUNTER(STAT_LaserApply);
+
+	HitRegistry.BeginFrame();
+	for (TWeakObjectPtr<ALaserGenerator> Generator : Generators)
+	{
+		if (Generator.IsValid())
+			Generator->GatherHits(HitRegistry);
+	}
+	HitRegistry.EndFrame();
+}
+
+bool ULaserSubsystem::IsTickable() const
+{
+	if (IsTemplate() || GetWorld()->GetNetMode() == NM_Client) return false;
+
+	return Generators.Num() > 0 || bHitsDirty;
+}
+
+ETickableTickType ULaserSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* ULaserSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId ULaserSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULaserSubsystem, STATGROUP_Tickables);
+}
+
+void ULaserSubsystem::TraceBatch(const TArray<ALaserGenerator*>& Batch, int32& RemainingSegments)
+{
+	// An even share each, decided up front so the outcome does not depend on which thread is faster.
+	// Never nothing, a dirty beam that may not trace a single ray never catches up
+	int32 Shares = 0;
+	for (int32 i = 0; i < Batch.Num(); ++i)
+	{
+		const int32 Share = FMath::Max(1, (RemainingSegments - Shares) / (Batch.Num() - i));
+		Batch[i]->PrepareTrace(Share);
+		Shares += Share;
+	}
+
+	// Traces are read only scene queries and every generator writes only its own path
+	ParallelFor(Batch.Num(), [&Batch](int32 Index)
+	{
+		Batch[Index]->TraceLaser();
+	}, Batch.Num() < 2);
+
+	// What a generator did not use goes to the next batch
+	for (ALaserGenerator* Generator : Batch)
+		RemainingSegments -= Generator->GetTracedSegmentNum();
+}
+
+void ULaserSubsystem::GetViews(TArray<FLaserView>& OutViews) const
+{
+	if (ViewOverride.IsSet())
+	{
+		OutViews.Add(ViewOverride.GetValue());
+		return;
+	}
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr) continue;
+
+		FLaserView& View = OutViews.AddDefaulted_GetRef();
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(View.Location, ViewRotation);
+
+		if (PlayerController->IsLocalController()) continue;
+
+		// The screen's aspect is not known here, a square as wide as the view covers it
+		const float FOV = PlayerController->PlayerCameraManager ? PlayerController->PlayerCameraManager->GetFOVAngle() : 90.f;
+		View.bUseFrustum = true;
+		View.Frustum = FPortalCaptureScheduler::MakeView(View.Location, ViewRotation, FOV, FIntPoint(1, 1)).Frustum;
+	}
+}
+
+void ULaserSubsystem::SetViewOverride(const FVector& Location, const FRotator& Rotation, float FOV)
+{
+	FLaserView View;
+	View.Location = Location;
+	View.bUseFrustum = true;
+	View.Frustum = FPortalCaptureScheduler::MakeView(Location, Rotation, FOV, FIntPoint(1, 1)).Frustum;
+	ViewOverride = View;
+}
+
+void ULaserSubsystem::ClearViewOverride()
+{
+	ViewOverride.Reset();
+}
+
+void ULaserSubsystem::RegisterGenerator(ALaserGenerator* Generator)
+{
+	Generators.AddUnique(Generator);
+}
+
+void ULaserSubsystem::UnregisterGenerator(ALaserGenerator* Generator)
+{
+	Generators.Remove(Generator);
+
+	// Its hits drop out of the next count
+	MarkHitsDirty();
+}
+
+void ULaserSubsystem::InvalidateComponent(UPrimitiveComponent* Component)
+{
+	if (Component == nullptr) return;
+
+	BVH.UpdateCollision(Component);
+	InvalidateGenerators(Component);
+}
+
+void ULaserSubsystem::InvalidateGenerators(UPrimitiveComponent* Component)
+{
+	const FBox Bounds = Component->Bounds.GetBox();
+	for (TWeakObjectPtr<ALaserGenerator> Generator : Generators)
+	{
+		if (Generator.IsValid())
+			Generator->InvalidateBounds(Component, Bounds);
+	}
+}
+
+void ULaserSubsystem::OnActorSpawned(AActor* Actor)
+{
+	AddActor(Actor);
+
+	// Something new may be standing in a beam already
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+		InvalidateComponent(Primitive);
+}
+
+void ULaserSubsystem::AddActor(AActor* Actor)
+{
+	if (Actor == nullptr) return;
+
+	WatchActor(Actor);
+	ResolveActor(Actor);
+	BVH.AddActor(Actor);
+
+	Actor->OnEndPlay.AddUniqueDynamic(this, &ULaserSubsystem::OnTrackedActorEndPlay);
+}
+
+void ULaserSubsystem::WatchActor(AActor* Actor)
+{
+	if (Actor == nullptr) return;
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		if (Primitive->Mobility != EComponentMobility::Movable) continue;
+		if (Primitive->TransformUpdated.IsBoundToObject(this)) continue;
+
+		Primitive->TransformUpdated.AddUObject(this, &ULaserSubsystem::OnWatchedComponentMoved);
+	}
+}
+
+void ULaserSubsystem::OnWatchedComponentMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	UPrimitiveComponent* Primitive = Cast<UPrimitiveComponent>(UpdatedComponent);
+	if (Primitive == nullptr) return;
+
+	BVH.UpdateComponent(Primitive);
+
+	if (FLaserBVH::CanBlockLaser(Primitive) == false) return;
+
+	InvalidateGenerators(Primitive);
+}
+
+void ULaserSubsystem::RegisterMirrorMaterial(UMaterialInterface* MirrorMaterial)
+{
+	if (MirrorMaterial == nullptr || MirrorMaterials.Contains(MirrorMaterial)) return;
+
+	MirrorMaterials.Add(MirrorMaterial);
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+		ResolveActor(*It);
+}
+
+void ULaserSubsystem::ResolveActor(AActor* Actor)
+{
+	if (Actor == nullptr) return;
+
+	ILaserInteractable* Interactable = Cast<ILaserInteractable>(Actor);
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		const ELaserResponse Response = ResolveComponent(Primitive, Interactable);
+		if (Response == ELaserResponse::NONE)
+		{
+			Responses.Remove(Primitive);
+			continue;
+		}
+
+		Responses.Add(Primitive, { Response, Interactable });
+	}
+}
+
+ELaserResponse ULaserSubsystem::ResolveComponent(UPrimitiveComponent* Component, ILaserInteractable* Interactable) const
+{
+	if (Interactable)
+		return Interactable->GetLaserResponse(Component);
+
+	if (IsMirrorMaterial(Component->GetMaterial(0)))
+		return ELaserResponse::REFLECT;
+
+	return ELaserResponse::NONE;
+}
+
+bool ULaserSubsystem::IsMirrorMaterial(UMaterialInterface* Material) const
+{
+	// Walk up the instance chain so instances of the mirror material reflect as well
+	while (Material)
+	{
+		if (MirrorMaterials.Contains(Material))
+			return true;
+
+		UMaterialInstance* MaterialInstance = Cast<UMaterialInstance>(Material);
+		Material = MaterialInstance ? MaterialInstance->Parent : nullptr;
+	}
+	return false;
+}
+
+void ULaserSubsystem::OnTrackedActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+		Responses.Remove(Primitive);
+
+	BVH.RemoveActor(Actor);
+}
+
+const FLaserBVH* ULaserSubsystem::GetLaserBVH()
+{
+	if (bUseLaserBVH == false) return nullptr;
+
+	BVH.Build();
+	return &BVH;
+}
+
+void ULaserSubsystem::BenchmarkBVH(const TArray<FString>& Args, UWorld* World)
+{
+	ULaserSubsystem* LaserSubsystem = World ? World->GetSubsystem<ULaserSubsystem>() : nullptr;
+	if (LaserSubsystem == nullptr) return;
+
+	const FLaserBVH* LaserBVH = LaserSubsystem->GetLaserBVH();
+	if (LaserBVH == nullptr || LaserBVH->GetNumLeaves() == 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Laser BVH is disabled or empty"));
+		return;
+	}
+
+	const int32 NumRays = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 10000;
+	const FBox Bounds = LaserBVH->GetBounds();
+
+	// Same rays for both so the timings compare, fixed seed so mismatches reproduce
+	FRandomStream RandomStream(NumRays);
+	TArray<TPair<FVector, FVector>> Rays;
+	Rays.Reserve(NumRays);
+	for (int32 i = 0; i < NumRays; ++i)
+	{
+		const FVector Start = RandomStream.RandPointInBox(Bounds);
+		Rays.Add(TPair<FVector, FVector>(Start, Start + RandomStream.VRand() * 10000.f));
+	}
+
+	const FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, true);
+	TArray<FHitResult> PhysicsHits;
+	PhysicsHits.SetNum(NumRays);
+	TArray<bool> PhysicsResults;
+	PhysicsResults.SetNum(NumRays);
+
+	double StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumRays; ++i)
+		PhysicsResults[i] = World->LineTraceSingleByChannel(PhysicsHits[i], Rays[i].Key, Rays[i].Value, ECollisionChannel::ECC_GameTraceChannel7, QueryParam);
+	const double PhysicsSeconds = FPlatformTime::Seconds() - StartTime;
+
+	int32 Mismatches = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (int32 i = 0; i < NumRays; ++i)
+	{
+		FHitResult HitResult;
+		const bool Result = LaserBVH->LineTrace(HitResult, Rays[i].Key, Rays[i].Value, ECollisionChannel::ECC_GameTraceChannel7, QueryParam);
+
+		if (Result != PhysicsResults[i] || (Result && (HitResult.GetComponent() != PhysicsHits[i].GetComponent() || FVector::DistSquared(HitResult.ImpactPoint, PhysicsHits[i].ImpactPoint) > 1.f)))
+			++Mismatches;
+	}
+	const double BVHSeconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Warning, TEXT("Laser BVH: %d leaves, %d rays, %d mismatches"), LaserBVH->GetNumLeaves(), NumRays, Mismatches);
+	UE_LOG(LogTemp, Warning, TEXT("Physics scene: %.0f rays/s, Laser BVH: %.0f rays/s"), NumRays / FMath::Max(PhysicsSeconds, 1e-6), NumRays / FMath::Max(BVHSeconds, 1e-6));
+}
+
+static FAutoConsoleCommandWithWorldAndArgs LaserBenchmarkBVHCommand(
+	TEXT("Laser.BenchmarkBVH"),
+	TEXT("Traces random rays through the laser BVH and the physics scene, logs mismatches and rays per second. Laser.BenchmarkBVH [NumRays]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ULaserSubsystem::BenchmarkBVH));
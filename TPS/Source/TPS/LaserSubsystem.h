@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "LaserHitRegistry.h"
+#include "LaserInteractable.h"
+#include "LaserBVH.h"
+#include "ConvexVolume.h"
+#include "LaserSubsystem.generated.h"
+
+// What the last tick of ULaserSubsystem did, for profiling
+struct FLaserTickStats
+{
+	double TraceSeconds = 0.0;
+	double ApplySeconds = 0.0;
+	int32 TracedGenerators = 0;
+	int32 TracedRays = 0;
+	int32 TracedSegments = 0;
+};
+
+// A player view beams are judged from
+struct FLaserView
+{
+	FVector Location;
+
+	// Set for views this machine does not draw, e.g. remote players on a listen server
+	bool bUseFrustum = false;
+	FConvexVolume Frustum;
+};
+
+/**
+ * World level bookkeeping for laser generators.
+ * Watches every movable primitive that blocks the laser channel and tells the
+ * generators when one of them moves, so a generator only re-traces when
+ * something could actually have changed its beam.
+ *
+ * Also traces the dirty generators once per frame: beams near a player and
+ * in their view are traced in parallel every frame. A view drawn on this
+ * machine goes by what was rendered, a remote player's by their frustum.
+ * Far ones share FarTraceBudgetMs and the oldest go first. All of them share SegmentBudgetPerFrame. Results are applied on the game thread in registration
+ * order, then the hits of all paths go through one FLaserHitRegistry so
+ * triggers and cubes switch only when the first beam arrives or the last one leaves.
+ *
+ * The laser response of every primitive is resolved once when its actor
+ * spawns and kept in a table the tracer reads without casts. With
+ * bUseLaserBVH the tracer also skips the physics scene for FLaserBVH.
+ *
+ * Only the server traces. Clients get the beams and the trigger and cube
+ * states through replication.
+ */
+UCLASS(config = Game)
+class TPS_API ULaserSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	ULaserSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterGenerator(class ALaserGenerator* Generator);
+	void UnregisterGenerator(class ALaserGenerator* Generator);
+
+	// For changes that do not move the component, e.g. a door turning its collision off.
+	// Also adds it to or drops it from FLaserBVH
+	void InvalidateComponent(UPrimitiveComponent* Component);
+
+	// Some path changed, re-count every hit at the end of this tick
+	void MarkHitsDirty() { bHitsDirty = true; }
+
+	const FLaserHitRegistry& GetHitRegistry() const { return HitRegistry; }
+
+	// Re-resolves every actor the first time a material is seen
+	void RegisterMirrorMaterial(class UMaterialInterface* MirrorMaterial);
+
+	const FLaserResponseTable& GetResponseTable() const { return Responses; }
+
+	const FLaserTickStats& GetLastTickStats() const { return LastTickStats; }
+
+	// Judges every beam from this view instead of the players', for worlds without any such as the stress commandlet
+	void SetViewOverride(const FVector& Location, const FRotator& Rotation, float FOV);
+	void ClearViewOverride();
+
+	// Built and ready to trace, nullptr when the physics scene should be traced instead
+	const FLaserBVH* GetLaserBVH();
+
+	// Laser.BenchmarkBVH [NumRays]
+	static void BenchmarkBVH(const TArray<FString>& Args, UWorld* World);
+
+private:
+
+	void OnActorSpawned(AActor* Actor);
+
+	void WatchActor(AActor* Actor);
+
+	// Re-traces every beam that may pass Component
+	void InvalidateGenerators(UPrimitiveComponent* Component);
+
+	void OnWatchedComponentMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	void AddActor(AActor* Actor);
+
+	void GetViews(TArray<FLaserView>& OutViews) const;
+
+	void TraceBatch(const TArray<class ALaserGenerator*>& Batch, int32& RemainingSegments);
+
+	void UpdateHits();
+
+	void ResolveActor(AActor* Actor);
+	ELaserResponse ResolveComponent(UPrimitiveComponent* Component, ILaserInteractable* Interactable) const;
+	bool IsMirrorMaterial(class UMaterialInterface* Material) const;
+
+	UFUNCTION()
+	void OnTrackedActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+private:
+
+	TArray<TWeakObjectPtr<class ALaserGenerator>> Generators;
+
+	// Time far beams may spend tracing per frame, whatever does not fit stays dirty for the next one
+	UPROPERTY(config)
+	float FarTraceBudgetMs;
+
+	// Beams further than this from every player camera, or off screen for all of them, are far
+	UPROPERTY(config)
+	float RelevantDistance;
+
+	// Segments all generators together may trace per frame. Near beams share it first,
+	// branches that do not fit stay pending, showing last frame's beam, and carry on next frame
+	UPROPERTY(config)
+	int32 SegmentBudgetPerFrame;
+
+	FDelegateHandle ActorSpawnedHandle;
+
+	FLaserHitRegistry HitRegistry;
+	bool bHitsDirty;
+
+	FLaserResponseTable Responses;
+
+	UPROPERTY()
+	TArray<class UMaterialInterface*> MirrorMaterials;
+
+	FLaserBVH BVH;
+
+	FLaserTickStats LastTickStats;
+
+	TOptional<FLaserView> ViewOverride;
+
+	UPROPERTY(config)
+	bool bUseLaserBVH;
+};
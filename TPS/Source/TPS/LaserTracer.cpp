@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LaserTracer.h"
+#include "LaserBVH.h"
+
+int32 FLaserTracer::Trace(const UWorld* World, const FLaserTraceSettings& Settings, TArrayView<const FLaserBeamSeed> Seeds, FLaserPath& Path)
+{
+	if (World == nullptr) return 0;
+
+	// Breadth first, so when the budget runs out it is the deepest branches that go without.
+	// Every entry becomes at most one ray, so the queue never needs more room than the path has for rays
+	TArray<FLaserBeamSeed, TFixedAllocator<FLaserPath::MaxRays>> Queue;
+	auto Enqueue = [&Queue, &Path](const FLaserBeamSeed& Seed)
+	{
+		if (Queue.Num() >= FLaserPath::MaxRays)
+		{
+			Path.bTruncated = true;
+			return;
+		}
+		Queue.Add(Seed);
+	};
+
+	for (const FLaserBeamSeed& Seed : Seeds)
+		Enqueue(Seed);
+
+	const int32 SegmentBudget = FMath::Clamp(Settings.SegmentBudget, 1, (int32)FLaserPath::MaxSegments);
+	const int32 FirstSegment = Path.Segments.Num();
+	FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, true, Settings.IgnoreActor);
+
+	for (int32 Head = 0; Head < Queue.Num(); ++Head)
+	{
+		if (Path.Segments.Num() >= SegmentBudget || Path.Rays.Num() >= FLaserPath::MaxRays)
+		{
+			Path.bTruncated = true;
+			break;
+		}
+
+		if (Path.Segments.Num() - FirstSegment >= Settings.FrameSegmentBudget)
+		{
+			QueuePending(Queue, Head, Path);
+			break;
+		}
+
+		// Queue may grow below, keep a copy
+		const FLaserBeamSeed Work = Queue[Head];
+		const int32 RayIndex = Path.Rays.Num();
+
+		FHitResult HitResult;
+		const bool Result = Settings.BVH
+			? Settings.BVH->LineTrace(HitResult, Work.Start, Work.Start + Work.Direction, ECollisionChannel::ECC_GameTraceChannel7, QueryParam)
+			: World->LineTraceSingleByChannel(HitResult, Work.Start, Work.Start + Work.Direction, ECollisionChannel::ECC_GameTraceChannel7, QueryParam);
+
+		AActor* HitActor = HitResult.GetActor();
+		const FIntVector EntryDirection = QuantizeDirection(Work.Direction);
+
+		// Reaching a ray of our own ancestry again is a loop, reaching one of another branch is two beams merging
+		const int32 VisitedRay = Result ? FindVisited(Path, HitActor, EntryDirection) : INDEX_NONE;
+		const bool bVisited = VisitedRay != INDEX_NONE;
+		const bool bLoop = bVisited && Path.IsAncestor(VisitedRay, Work.Parent);
+
+		FLaserRay& Ray = Path.Rays.AddDefaulted_GetRef();
+		Ray.Start = Work.Start;
+		Ray.Direction = Work.Direction;
+		Ray.ReflectionCount = Work.ReflectionCount;
+		Ray.Parent = Work.Parent;
+		Ray.FirstSegment = Path.Segments.Num();
+		Ray.bPending = false;
+
+		ILaserInteractable* Interactable = nullptr;
+		Ray.HitType = Result ? ClassifyHit(Settings, HitResult, Path, Interactable) : ELaserHitType::NONE;
+		Ray.HitActor = HitActor;
+		Ray.HitComponent = HitResult.GetComponent();
+		Ray.EntryDirection = EntryDirection;
+
+		FLaserExits Exits;
+		if (Ray.HitType == ELaserHitType::PORTAL || Ray.HitType == ELaserHitType::LASER_CUBE)
+			Interactable->GetLaserExits(HitResult, Work.Direction, Exits);
+
+		if (Ray.HitType == ELaserHitType::LASER_CUBE)
+		{
+			// The impact, one segment into the cube and one out per exit
+			const int32 CubeSegments = 2 + Exits.Num();
+
+			if (Path.Segments.Num() > FirstSegment && Path.Segments.Num() - FirstSegment + CubeSegments > Settings.FrameSegmentBudget)
+			{
+				// Trace the whole cube next frame rather than half of it now, unless it is the first thing traced
+				Path.Rays.Pop(false);
+				QueuePending(Queue, Head, Path);
+				break;
+			}
+
+			// Cut the beam at the cube when it does not fit the path at all
+			if (Path.Segments.Num() + CubeSegments > SegmentBudget)
+			{
+				Ray.HitType = ELaserHitType::OTHER;
+				Path.bTruncated = true;
+			}
+		}
+
+		switch (Ray.HitType)
+		{
+		case ELaserHitType::NONE:
+			Path.Segments.Add({ Work.Start, Work.Start + Work.Direction });
+			break;
+		case ELaserHitType::PORTAL:
+			Path.Segments.Add({ Work.Start, HitResult.ImpactPoint });
+
+			for (const FLaserExit& Exit : Exits)
+			{
+				Ray.LinkedComponent = Exit.LinkedComponent;
+				if (bVisited) break;
+
+				Enqueue({ Exit.Start, Exit.Direction, Work.ReflectionCount, RayIndex });
+			}
+			break;
+		case ELaserHitType::MIRROR:
+		{
+			Path.Segments.Add({ Work.Start, HitResult.ImpactPoint });
+
+			if (Work.ReflectionCount == 0 || bVisited) break;
+
+			FVector ImpactNormal = HitResult.ImpactNormal;
+			FVector NextDirection = 2 * ImpactNormal * FVector::DotProduct(ImpactNormal, -1.f * Work.Direction) + Work.Direction;
+
+			Enqueue({ HitResult.ImpactPoint, NextDirection, Work.ReflectionCount - 1, RayIndex });
+			break;
+		}
+		case ELaserHitType::LASER_CUBE:
+		{
+			Path.Segments.Add({ Work.Start, HitResult.ImpactPoint });
+
+			bool bDrawnThrough = false;
+			for (const FLaserExit& Exit : Exits)
+			{
+				if (Exit.bDrawThrough)
+				{
+					if (bDrawnThrough == false)
+						Path.Segments.Add({ HitResult.ImpactPoint, Exit.Through });
+					Path.Segments.Add({ Exit.Through, Exit.Start });
+					bDrawnThrough = true;
+				}
+
+				if (bVisited == false)
+					Enqueue({ Exit.Start, Exit.Direction, Work.ReflectionCount, RayIndex });
+			}
+			break;
+		}
+		case ELaserHitType::TRIGGER:
+		case ELaserHitType::OTHER:
+		default:
+			Path.Segments.Add({ Work.Start, HitResult.ImpactPoint });
+			break;
+		}
+
+		if (bLoop)
+			Path.bTruncated = true;
+	}
+
+	return Path.Segments.Num() - FirstSegment;
+}
+
+void FLaserTracer::QueuePending(TArrayView<const FLaserBeamSeed> Queue, int32 Head, FLaserPath& Path)
+{
+	for (int32 i = Head; i < Queue.Num(); ++i)
+	{
+		if (Path.Rays.Num() >= FLaserPath::MaxRays)
+		{
+			Path.bTruncated = true;
+			return;
+		}
+
+		if (Path.FirstPendingRay == INDEX_NONE)
+			Path.FirstPendingRay = Path.Rays.Num();
+
+		FLaserRay& Ray = Path.Rays.AddDefaulted_GetRef();
+		Ray.Start = Queue[i].Start;
+		Ray.Direction = Queue[i].Direction;
+		Ray.ReflectionCount = Queue[i].ReflectionCount;
+		Ray.Parent = Queue[i].Parent;
+		Ray.FirstSegment = Path.Segments.Num();
+		Ray.bPending = true;
+		Ray.HitType = ELaserHitType::NONE;
+	}
+}
+
+FIntVector FLaserTracer::QuantizeDirection(const FVector& Direction)
+{
+	// About half a degree per step, close enough to call two entries the same
+	const FVector Normal = Direction.GetSafeNormal() * 128.f;
+	return FIntVector(FMath::RoundToInt(Normal.X), FMath::RoundToInt(Normal.Y), FMath::RoundToInt(Normal.Z));
+}
+
+ELaserHitType FLaserTracer::ClassifyHit(const FLaserTraceSettings& Settings, const FHitResult& HitResult, const FLaserPath& Path, ILaserInteractable*& OutInteractable)
+{
+	if (Settings.Responses == nullptr) return ELaserHitType::OTHER;
+
+	const FLaserResponseEntry* Entry = Settings.Responses->Find(HitResult.GetComponent());
+	if (Entry == nullptr) return ELaserHitType::OTHER;
+
+	OutInteractable = Entry->Interactable;
+
+	switch (Entry->Response)
+	{
+	case ELaserResponse::REFLECT:
+		return ELaserHitType::MIRROR;
+	case ELaserResponse::PORTAL:
+		return OutInteractable ? ELaserHitType::PORTAL : ELaserHitType::OTHER;
+	case ELaserResponse::TRIGGER:
+		return ELaserHitType::TRIGGER;
+	case ELaserResponse::REDIRECT:
+		// Each cube redirects once per tree, a second hit would only retrace the same exits
+		if (OutInteractable == nullptr || Path.HasRedirected(HitResult.GetActor())) return ELaserHitType::OTHER;
+		return ELaserHitType::LASER_CUBE;
+	default:
+		return ELaserHitType::OTHER;
+	}
+}
+
+int32 FLaserTracer::FindVisited(const FLaserPath& Path, const AActor* HitActor, const FIntVector& EntryDirection)
+{
+	for (int32 i = 0; i < Path.Rays.Num(); ++i)
+	{
+		if (Path.Rays[i].HitActor == HitActor && Path.Rays[i].EntryDirection == EntryDirection)
+			return i;
+	}
+	return INDEX_NONE;
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "LaserPath.h"
+#include "LaserInteractable.h"
+
+struct FLaserTraceSettings
+{
+	const AActor* IgnoreActor = nullptr;
+
+	// Owned by ULaserSubsystem, must not change while a trace runs
+	const FLaserResponseTable* Responses = nullptr;
+
+	// Traced instead of the physics scene when set, also owned by ULaserSubsystem
+	const class FLaserBVH* BVH = nullptr;
+
+	// Hard cap on segments per path, clamped to FLaserPath::MaxSegments
+	int32 SegmentBudget = FLaserPath::MaxSegments;
+
+	// Segments this trace may add, whatever is left in the queue becomes pending rays
+	int32 FrameSegmentBudget = MAX_int32;
+};
+
+/**
+ * Iterative laser tracer. Follows mirrors, portals and laser cubes breadth
+ * first with an explicit queue instead of recursion, so a pair of facing
+ * portals or cubes can neither blow the stack nor trace forever, and a
+ * splitter cube just queues one child beam per exit. Tracing only fills the
+ * path; turning triggers and cubes on is left to whoever reads it.
+ * Hits are classified through the cached response table, see ILaserInteractable.
+ */
+class TPS_API FLaserTracer
+{
+public:
+
+	// Appends the tree grown from Seeds to Path, returns how many segments it added.
+	// Seeds must come in the order their rays had, see FLaserPath::Truncate
+	static int32 Trace(const UWorld* World, const FLaserTraceSettings& Settings, TArrayView<const FLaserBeamSeed> Seeds, FLaserPath& Path);
+
+	static FIntVector QuantizeDirection(const FVector& Direction);
+
+private:
+
+	static ELaserHitType ClassifyHit(const FLaserTraceSettings& Settings, const FHitResult& HitResult, const FLaserPath& Path, ILaserInteractable*& OutInteractable);
+
+	static int32 FindVisited(const FLaserPath& Path, const AActor* HitActor, const FIntVector& EntryDirection);
+
+	static void QueuePending(TArrayView<const FLaserBeamSeed> Queue, int32 Head, FLaserPath& Path);
+};
@@ -6,44 +6,84 @@
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
 #include "Components/BoxComponent.h"
+#include "Net/UnrealNetwork.h"
 
 ALaserTrigger::ALaserTrigger()
 {
 	Trigger->SetCollisionProfileName(FName(TEXT("LaserTrigger")));
+
+	bReplicates = true;
 }
 
-void ALaserTrigger::LaserTriggerOn()
+void ALaserTrigger::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	if (MI_TriggerOn && SwitchTimeline)
-	{
-		Switch->SetMaterial(0, MI_TriggerOn);
-		SwitchTimeline->Play();
-		bIsLaserTriggerOn = true;
-	}
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	ActiveLane();
+	DOREPLIFETIME(ALaserTrigger, bIsLaserTriggerOn);
+}
+
+void ALaserTrigger::LaserTriggerOn()
+{
+	bIsLaserTriggerOn = true;
+	PlaySwitch(true);
 
 	for (ABasicPlatform* Platform : PlaformsConnectedToTrigger)
 		Platform->AddActiveTrigger();
-
-	if (SC_On)
-		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_On, GetActorLocation());
 }
 
 void ALaserTrigger::LaserTriggerOff()
 {
-	if (MI_TriggerOff && SwitchTimeline)
+	bIsLaserTriggerOn = false;
+	PlaySwitch(false);
+
+	for (ABasicPlatform* Platform : PlaformsConnectedToTrigger)
+		Platform->RemoveActiveTrigger();
+}
+
+void ALaserTrigger::OnRep_IsLaserTriggerOn()
+{
+	PlaySwitch(bIsLaserTriggerOn);
+}
+
+void ALaserTrigger::PlaySwitch(bool bOn)
+{
+	if (bOn)
 	{
-		Switch->SetMaterial(0, MI_TriggerOff);
-		SwitchTimeline->Reverse();
-		bIsLaserTriggerOn = false;
+		if (MI_TriggerOn)
+		{
+			Switch->SetMaterial(0, MI_TriggerOn);
+			PlaySwitchTween(true);
+		}
+
+		ActiveLane();
+
+		if (SC_On)
+			UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_On, GetActorLocation());
 	}
+	else
+	{
+		if (MI_TriggerOff)
+		{
+			Switch->SetMaterial(0, MI_TriggerOff);
+			PlaySwitchTween(false);
+		}
 
-	InActiveLane();
+		InActiveLane();
 
-	for (ABasicPlatform* Platform : PlaformsConnectedToTrigger)
-		Platform->RemoveActiveTrigger();
+		if (SC_Off)
+			UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_Off, GetActorLocation());
+	}
+}
 
-	if (SC_Off)
-		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_Off, GetActorLocation());
-}
\ No newline at end of file
+ELaserResponse ALaserTrigger::GetLaserResponse(const UPrimitiveComponent* Component) const
+{
+	return ELaserResponse::TRIGGER;
+}
+
+void ALaserTrigger::SetLaserLit(bool bLit)
+{
+	if (bLit)
+		LaserTriggerOn();
+	else
+		LaserTriggerOff();
+}
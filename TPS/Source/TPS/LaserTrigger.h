@@ -4,26 +4,40 @@
 
 #include "CoreMinimal.h"
 #include "PlatformTrigger.h"
+#include "LaserInteractable.h"
 #include "LaserTrigger.generated.h"
 
 /**
  * 
  */
 UCLASS()
-class TPS_API ALaserTrigger : public APlatformTrigger
+class TPS_API ALaserTrigger : public APlatformTrigger, public ILaserInteractable
 {
 	GENERATED_BODY()
 	
 private:
 
+	// Set by the server's hit registry, clients only play the switch
+	UPROPERTY(ReplicatedUsing = OnRep_IsLaserTriggerOn)
 	bool bIsLaserTriggerOn;
 
+	UFUNCTION()
+	void OnRep_IsLaserTriggerOn();
+
+	void PlaySwitch(bool bOn);
+
 public:
 
 	ALaserTrigger();
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 	bool GetIsLaserTriggerOn() const { return bIsLaserTriggerOn; };
 
 	void LaserTriggerOn();
 	void LaserTriggerOff();
+
+	// ILaserInteractable
+	virtual ELaserResponse GetLaserResponse(const UPrimitiveComponent* Component) const override;
+	virtual void SetLaserLit(bool bLit) override;
 };
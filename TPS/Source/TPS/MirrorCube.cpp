@@ -2,23 +2,17 @@
 
 
 #include "MirrorCube.h"
-#include "Portal.h"
-#include "Components/ArrowComponent.h"
 
 AMirrorCube::AMirrorCube()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	// Its copy at a linked portal is a clone from UPortalSubsystem, nothing to do per frame
+	PrimaryActorTick.bCanEverTick = false;
 
 	Mesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("MESH"));
 	RootComponent = Mesh;
 	Mesh->SetCollisionProfileName(FName(TEXT("PhysicsActor")));
 	Mesh->SetSimulatePhysics(true);
-
-	PortalMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("PORTALMESH"));
-	PortalMesh->SetCollisionProfileName(FName(TEXT("NoCollision")));
-	PortalMesh->SetupAttachment(RootComponent);
-	PortalMesh->SetHiddenInGame(true);
-	PortalMesh->SetGenerateOverlapEvents(false);
+	SetupPortalPhysics(Mesh);
 }
 
 void AMirrorCube::SetVelocity(FVector velocity)
@@ -26,38 +20,7 @@ void AMirrorCube::SetVelocity(FVector velocity)
 	Mesh->SetPhysicsLinearVelocity(velocity);
 }
 
-void AMirrorCube::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-	SetPortalMesh();
-}
-
-void AMirrorCube::SetPortalMesh()
-{
-	if (Portal.IsValid())
-	{
-		FVector RootLocation = GetActorLocation();
-		FVector RelativeLocation = Portal->Arrow->GetComponentTransform().InverseTransformPositionNoScale(RootLocation);
-		FVector GlobalLocation = Portal->LinkedPortal->GetTransform().TransformPositionNoScale(RelativeLocation);
-
-		FQuat RootQuat = FQuat(GetActorRotation());
-		FQuat RelativeQuat = Portal->Arrow->GetComponentTransform().InverseTransformRotation(RootQuat);
-		FQuat GlobalQuat = Portal->LinkedPortal->GetTransform().TransformRotation(RelativeQuat);
-		FRotator GlobalRotator = GlobalQuat.Rotator();
-
-		PortalMesh->SetWorldLocationAndRotation(GlobalLocation, GlobalRotator);
-	}
-}
-
-void AMirrorCube::SetPortal(APortal* portal)
-{
-	Portal = portal;
-	PortalMesh->SetHiddenInGame(false);
-}
-
-void AMirrorCube::ResetPortal()
+ELaserResponse AMirrorCube::GetLaserResponse(const UPrimitiveComponent* Component) const
 {
-	Portal.Reset();
-	PortalMesh->SetHiddenInGame(true);
+	return Component == Mesh ? ELaserResponse::REFLECT : ELaserResponse::NONE;
 }
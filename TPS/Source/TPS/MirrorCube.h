@@ -4,13 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "GrabableActor.h"
+#include "LaserInteractable.h"
 #include "MirrorCube.generated.h"
 
 /**
  * 
  */
 UCLASS()
-class TPS_API AMirrorCube : public AGrabableActor
+class TPS_API AMirrorCube : public AGrabableActor, public ILaserInteractable
 {
 	GENERATED_BODY()
 	
@@ -19,20 +20,12 @@ public:
 	AMirrorCube();
 
 	virtual void SetVelocity(FVector velocity) override;
-	
-	virtual void Tick(float DeltaTime) override;
 
-	void SetPortalMesh();
-	void SetPortal(class APortal* portal);
-	void ResetPortal();
+	// ILaserInteractable
+	virtual ELaserResponse GetLaserResponse(const UPrimitiveComponent* Component) const override;
 
 private:
 
 	UPROPERTY(VisibleAnywhere)
 	UStaticMeshComponent* Mesh;
-
-	UPROPERTY(VisibleAnywhere)
-	UStaticMeshComponent* PortalMesh;
-
-	TWeakObjectPtr<class APortal> Portal;
 };
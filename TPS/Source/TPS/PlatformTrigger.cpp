@@ -4,7 +4,7 @@
 #include "PlatformTrigger.h"
 #include "Components/BoxComponent.h"
 #include "MovingPlatform.h"
-#include "Components/TimelineComponent.h"
+#include "TweenSubsystem.h"
 #include "PlatformConnectLane.h"
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
@@ -13,7 +13,7 @@
 APlatformTrigger::APlatformTrigger()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bCanEverTick = false;
 
 	Trigger = CreateDefaultSubobject<UBoxComponent>(TEXT("TRIGGER"));
 	Trigger->SetBoxExtent(FVector(50.f, 50.f, 15.f));
@@ -27,8 +27,6 @@ APlatformTrigger::APlatformTrigger()
 	Border->SetupAttachment(RootComponent);
 	Border->SetRelativeLocation(FVector(0.f, 0.f, -10.f));
 	Border->SetRelativeScale3D(FVector(1.2f, 1.2f, 0.1f));
-
-	SwitchTimeline = CreateDefaultSubobject<UTimelineComponent>(TEXT("TIMELINE"));
 }
 
 void APlatformTrigger::ActiveLane()
@@ -60,17 +58,15 @@ void APlatformTrigger::PostInitializeComponents()
 
 	Trigger->OnComponentBeginOverlap.AddDynamic(this, &APlatformTrigger::OnBeginOverlapTrigger);
 	Trigger->OnComponentEndOverlap.AddDynamic(this, &APlatformTrigger::OnEndOverlapTrigger);
+}
 
-	UpdateFunction.BindUFunction(this, FName("TimelineUpdate"));
-	FinishFunction.BindUFunction(this, FName("TimelineFinish"));
+void APlatformTrigger::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
 
-	if (SwitchTimeline && FloatCurve)
-	{
-		SwitchTimeline->AddInterpFloat(FloatCurve, UpdateFunction);
-		SwitchTimeline->SetTimelineFinishedFunc(FinishFunction);
-		SwitchTimeline->SetLooping(false);
-		SwitchTimeline->SetPlayRate(3.f);
-	}
+	UTweenSubsystem* TweenSubsystem = GetWorld()->GetSubsystem<UTweenSubsystem>();
+	if (TweenSubsystem)
+		TweenSubsystem->StopAll(this);
 }
 
 void APlatformTrigger::OnConstruction(const FTransform& Transform)
@@ -87,10 +83,10 @@ void APlatformTrigger::OnBeginOverlapTrigger(UPrimitiveComponent* OverlappedComp
 
 	if (OverlapedActorNum > 1) return;
 
-	if (MI_TriggerOn && SwitchTimeline)
+	if (MI_TriggerOn)
 	{
 		Switch->SetMaterial(0, MI_TriggerOn);
-		SwitchTimeline->Play();
+		PlaySwitchTween(true);
 		ActiveLane();
 	}
 
@@ -108,10 +104,10 @@ void APlatformTrigger::OnEndOverlapTrigger(UPrimitiveComponent* OverlappedCompon
 
 	if (OverlapedActorNum != 0) return;
 
-	if (MI_TriggerOff && SwitchTimeline)
+	if (MI_TriggerOff)
 	{
 		Switch->SetMaterial(0, MI_TriggerOff);
-		SwitchTimeline->Reverse();
+		PlaySwitchTween(false);
 		InActiveLane();
 	}
 
@@ -122,20 +118,22 @@ void APlatformTrigger::OnEndOverlapTrigger(UPrimitiveComponent* OverlappedCompon
 		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_Off, GetActorLocation());
 }
 
-void APlatformTrigger::TimelineUpdate(float value)
-{
-	Switch->SetRelativeLocation(FMath::Lerp(StartSwitchLocation, FinishSwitchLocation, value));
-}
-
-void APlatformTrigger::TimelineFinish()
+void APlatformTrigger::PlaySwitchTween(bool bPress)
 {
-}
+	UTweenSubsystem* TweenSubsystem = GetWorld()->GetSubsystem<UTweenSubsystem>();
+	if (TweenSubsystem == nullptr) return;
 
+	// Turn around mid press instead of jumping to the other end
+	if (TweenSubsystem->SetReverse(SwitchTween, bPress == false)) return;
 
+	FTweenSettings Settings;
+	Settings.Curve = FloatCurve;
+	Settings.Duration = FloatCurve ? 0.f : 1.f;
+	Settings.PlayRate = 3.f;
+	Settings.bReverse = bPress == false;
 
-// Called every frame
-void APlatformTrigger::Tick(float DeltaTime)
-{
-	Super::Tick(DeltaTime);
-
-}
\ No newline at end of file
+	SwitchTween = TweenSubsystem->Play(this, Settings, [this](float Alpha)
+	{
+		Switch->SetRelativeLocation(FMath::Lerp(StartSwitchLocation, FinishSwitchLocation, Alpha));
+	});
+}
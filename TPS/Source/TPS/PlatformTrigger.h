@@ -4,8 +4,6 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
-#include "Components/TimelineComponent.h"
-
 #include "PlatformTrigger.generated.h"
 
 UCLASS()
@@ -34,16 +32,9 @@ protected:
 	UFUNCTION()
 	void OnEndOverlapTrigger(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	UFUNCTION()
-	void TimelineUpdate(float value);
-
-	UFUNCTION()
-	void TimelineFinish();
-
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	void PlaySwitchTween(bool bPress);
 
 protected:
 
@@ -75,14 +66,11 @@ protected:
 
 
 
-	UPROPERTY(VisibleAnywhere)
-	class UTimelineComponent* SwitchTimeline;
-
+	// Shape of the switch press, played 3 times faster than authored
 	UPROPERTY(EditDefaultsOnly)
 	class UCurveFloat* FloatCurve;
 
-	FOnTimelineFloat UpdateFunction;
-	FOnTimelineEvent FinishFunction;
+	uint32 SwitchTween = 0;
 
 	UPROPERTY(EditInstanceOnly, Category = "BasicSetting")
 	TArray<class APlatformConnectLane*> PlatformConnectLanes;
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PlayerAimComponent.h"
+#include "GameFramework/Pawn.h"
+#include "PortalSubsystem.h"
+#include "PortalWall.h"
+#include "GrabableActor.h"
+#include "LaserCube.h"
+
+DECLARE_CYCLE_STAT(TEXT("Player Aim"), STAT_PlayerAim, STATGROUP_Game);
+
+UPlayerAimComponent::UPlayerAimComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+
+	// After everything that moves the character this frame
+	PrimaryComponentTick.TickGroup = TG_LastDemotable;
+
+	PortalRange = 10000.f;
+	GrabRange = 200.f;
+}
+
+void UPlayerAimComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Pawn == nullptr || Pawn->IsLocallyControlled() == false) return;
+
+	for (int32 i = 0; i < (int32)EAimChannel::Num; ++i)
+		UpdateAim((EAimChannel)i);
+}
+
+const FAimHit& UPlayerAimComponent::GetAim(EAimChannel Channel)
+{
+	FAimHit& Hit = Hits[(int32)Channel];
+	if (Hit.Frame + 1 < GFrameCounter)
+		UpdateAim(Channel);
+
+	return Hit;
+}
+
+void UPlayerAimComponent::UpdateAim(EAimChannel Channel)
+{
+	FAimHit& Hit = Hits[(int32)Channel];
+	if (Hit.Frame == GFrameCounter) return;
+
+	SCOPE_CYCLE_COUNTER(STAT_PlayerAim);
+
+	Hit.Frame = GFrameCounter;
+	Hit.TraceResult = FPortalTraceResult();
+	Hit.TargetType = EAimTargetType::NONE;
+
+	UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>();
+	if (PortalSubsystem == nullptr || AimCamera == nullptr) return;
+
+	// The camera component only takes the control rotation when the camera manager updates, after every tick group
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	const FRotator AimRotation = Pawn ? Pawn->GetViewRotation() : AimCamera->GetComponentRotation();
+
+	const bool bPortal = Channel == EAimChannel::Portal;
+	FVector Start = AimCamera->GetComponentLocation();
+	FVector End = Start + AimRotation.Vector() * (bPortal ? PortalRange : GrabRange);
+	FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, false, GetOwner());
+	ECollisionChannel TraceChannel = bPortal ? ECollisionChannel::ECC_GameTraceChannel1 : ECollisionChannel::ECC_GameTraceChannel6;
+
+	// Portals can be shot and cubes grabbed through the other portal
+	if (PortalSubsystem->LineTraceThroughPortals(Start, End, TraceChannel, QueryParam, Hit.TraceResult))
+		Hit.TargetType = ClassifyHit(Channel, Hit.GetHitActor());
+}
+
+EAimTargetType UPlayerAimComponent::ClassifyHit(EAimChannel Channel, const AActor* HitActor)
+{
+	if (HitActor == nullptr) return EAimTargetType::OTHER;
+
+	if (Channel == EAimChannel::Portal)
+		return HitActor->IsA<APortalWall>() ? EAimTargetType::PORTAL_WALL : EAimTargetType::OTHER;
+
+	if (HitActor->IsA<ALaserCube>())
+		return EAimTargetType::LASER_CUBE;
+
+	return HitActor->IsA<AGrabableActor>() ? EAimTargetType::GRABABLE : EAimTargetType::OTHER;
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "PortalTrace.h"
+#include "PlayerAimComponent.generated.h"
+
+enum class EAimChannel : uint8
+{
+	Portal,
+	Grab,
+
+	Num
+};
+
+enum class EAimTargetType : uint8
+{
+	NONE,
+	PORTAL_WALL,
+	GRABABLE,
+	LASER_CUBE,
+
+	OTHER
+};
+
+struct FAimHit
+{
+	FPortalTraceResult TraceResult;
+	EAimTargetType TargetType = EAimTargetType::NONE;
+
+	// GFrameCounter of the trace, 0 before the first one
+	uint64 Frame = 0;
+
+	const FHitResult* GetBlockingHit() const { return TraceResult.GetBlockingHit(); }
+	AActor* GetHitActor() const { return TraceResult.bBlockingHit ? TraceResult.GetBlockingHit()->GetActor() : nullptr; }
+};
+
+/**
+ * What the local player's camera is looking at. Traces the portal channel and
+ * the grab channel through portals once per frame after the character moved, and
+ * classifies what they hit. Input and the HUD both read the cached hits, so
+ * shooting a portal, grabbing and crosshair feedback cost one trace per channel.
+ * A hit from the end of the last frame is what the player saw when pressing the button.
+ */
+UCLASS(ClassGroup = (Portal))
+class TPS_API UPlayerAimComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPlayerAimComponent();
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	void SetAimCamera(USceneComponent* Camera) { AimCamera = Camera; }
+
+	// Traces right away only when the cached hit is older than the last frame
+	const FAimHit& GetAim(EAimChannel Channel);
+
+	float GetGrabRange() const { return GrabRange; }
+	float GetPortalRange() const { return PortalRange; }
+
+private:
+
+	void UpdateAim(EAimChannel Channel);
+
+	static EAimTargetType ClassifyHit(EAimChannel Channel, const AActor* HitActor);
+
+private:
+
+	UPROPERTY()
+	USceneComponent* AimCamera;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Aim")
+	float PortalRange;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Aim")
+	float GrabRange;
+
+	FAimHit Hits[(int32)EAimChannel::Num];
+};
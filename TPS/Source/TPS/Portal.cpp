@@ -14,14 +14,20 @@
 #include "Components/ArrowComponent.h"
 #include "Sound/SoundCue.h"
 #include "GrabableActor.h"
-#include "MirrorCube.h"
-#include "PortalGameInstance.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "PortalSubsystem.h"
+#include "LaserSubsystem.h"
+#include "PortalCollisionFilter.h"
+#include "PortalWall.h"
+#include "PortalCharacterMovementComponent.h"
+#include "GameFramework/PlayerState.h"
+#include "Net/UnrealNetwork.h"
 
 // Sets default values
 APortal::APortal()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Transits are resolved by UPortalSubsystem for all portals at once
+	PrimaryActorTick.bCanEverTick = false;
 
 	Scene = CreateDefaultSubobject<USceneComponent>(TEXT("SCENE"));
 	RootComponent = Scene;
@@ -43,31 +49,47 @@ APortal::APortal()
 	SceneCapture = CreateDefaultSubobject<USceneCaptureComponent2D>(TEXT("SCENE CAPTURE"));
 	SceneCapture->SetupAttachment(RootComponent);
 	SceneCapture->bOverride_CustomNearClippingPlane = true;
+	// UPortalSubsystem decides when to capture
+	SceneCapture->bCaptureEveryFrame = false;
+	SceneCapture->bCaptureOnMovement = false;
 
 	Arrow = CreateDefaultSubobject<UArrowComponent>(TEXT("ARROW"));
 	Arrow->SetRelativeRotation(FRotator(0.f, 180.f, 0.f));
 	Arrow->SetupAttachment(RootComponent);
+
+	RenderTargetParameter = TEXT("RenderTarget");
+
+	// Only the placement replicates and it never changes
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	NetUpdateFrequency = 1.f;
+}
+
+void APortal::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(APortal, Placement, COND_InitialOnly);
 }
 
 void APortal::OnConstruction(const FTransform& Transform)
 {
 	Super::OnConstruction(Transform);
 
+	SetBorderMaterial();
+}
+
+void APortal::SetBorderMaterial()
+{
 	if (PortalA)
 	{
-		if (MI_PortalBoderA && RenderTargetB)
-		{
+		if (MI_PortalBoderA)
 			PortalBorder->SetMaterial(0, MI_PortalBoderA);
-			SceneCapture->TextureTarget = RenderTargetB;
-		}
 	}
 	else
 	{
-		if (MI_PortalBoderB && RenderTargetA)
-		{
+		if (MI_PortalBoderB)
 			PortalBorder->SetMaterial(0, MI_PortalBoderB);
-			SceneCapture->TextureTarget = RenderTargetA;
-		}
 	}
 }
 
@@ -75,23 +97,21 @@ void APortal::OnConstruction(const FTransform& Transform)
 void APortal::BeginPlay()
 {
 	Super::BeginPlay();
-	
-	Character = Cast<ATPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
 
 	PortalBody->OnComponentBeginOverlap.AddDynamic(this, &APortal::OnPortalBeginOverlap);
 	PortalBody->OnComponentEndOverlap.AddDynamic(this, &APortal::OnPortalEndOverlap);
 
-	PortalPlane->OnComponentBeginOverlap.AddDynamic(this, &APortal::OnPlaneBeginOverlap);
-	PortalPlane->OnComponentEndOverlap.AddDynamic(this, &APortal::OnPlaneEndOverlap);
+	// Both sides map through this portal's transform
+	RootComponent->TransformUpdated.AddUObject(this, &APortal::OnPortalMoved);
+	UpdatePortalLink();
+	if (LinkedPortal.IsValid())
+		LinkedPortal->UpdatePortalLink();
 
-	GameInstance = Cast<UPortalGameInstance>(GetGameInstance());
-	if (GameInstance)
-		PortalQualityDelegateHandle = GameInstance->OnChangePortalQualityDelegate.AddUObject(this, &APortal::OnChangePortalQulity);
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+		PortalSubsystem->RegisterPortal(this);
 
-	if (GameInstance)
-		OnChangePortalQulity(GameInstance->GetPortalQuality());
-	else
-		OnChangePortalQulity(0.4f);
+	if (APortalWall* PortalWall = GetPortalWall())
+		PortalWall->AddPortal(this);
 }
 
 void APortal::EndPlay(const EEndPlayReason::Type EndPlayReason)
@@ -101,7 +121,23 @@ void APortal::EndPlay(const EEndPlayReason::Type EndPlayReason)
 	if (LinkedPortal.IsValid())
 		LinkedPortal->ResetPortalMaterial();
 
-	GameInstance->OnChangePortalQualityDelegate.Remove(PortalQualityDelegateHandle);
+	OnPortalLinkChanged.Broadcast(this);
+
+	while (TransitBodies.Num() > 0)
+		RemoveTransitBody(TransitBodies.Num() - 1);
+
+	if (WallComponent.IsValid())
+		WallComponent->OnComponentPhysicsStateChanged.RemoveDynamic(this, &APortal::OnPhysicsStateChanged);
+
+	if (APortalWall* PortalWall = GetPortalWall())
+		PortalWall->RemovePortal(this);
+
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+	{
+		PortalSubsystem->ReleaseRenderTarget(ViewTarget);
+		PortalSubsystem->UnregisterPortal(this);
+	}
+	SetViewTarget(nullptr);
 }
 
 void APortal::LinkPortal(TWeakObjectPtr<APortal> LinkPortal)
@@ -112,99 +148,268 @@ void APortal::LinkPortal(TWeakObjectPtr<APortal> LinkPortal)
 		LinkPortal->LinkPortal(this);
 	}
 
+	UpdatePortalLink();
 	SetPortalMaterial();
+
+	OnPortalLinkChanged.Broadcast(this);
 }
 
-// Called every frame
-void APortal::Tick(float DeltaTime)
+void APortal::SetLinkedPortal(APortal* Portal)
 {
-	Super::Tick(DeltaTime);
+	if (LinkedPortal.Get() == Portal) return;
 
-	CheckPlayerTeleport();
-	CheckActorTeleport();
+	LinkedPortal = Portal;
+	if (Portal)
+	{
+		UpdatePortalLink();
+		SetPortalMaterial();
+	}
+	else
+	{
+		ResetPortalMaterial();
+	}
 
-	SetCameraPosition();
+	OnPortalLinkChanged.Broadcast(this);
 }
 
-void APortal::OnPortalBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void APortal::SetPortalHidden(bool bHidden)
 {
-	if (LinkedPortal.IsValid() == false)
-		return;
+	if (IsHidden() == bHidden) return;
+
+	if (bHidden)
+		SetLinkedPortal(nullptr);
+
+	SetActorHiddenInGame(bHidden);
+	SetActorEnableCollision(bHidden == false);
 
-	ATPSCharacter* Pawn = Cast<ATPSCharacter>(OtherActor);
-	if (Pawn)
+	// The laser can hit it again or no longer
+	if (ULaserSubsystem* LaserSubsystem = GetWorld()->GetSubsystem<ULaserSubsystem>())
 	{
-		OverlapedCharacter = Pawn;
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(this);
+		for (UPrimitiveComponent* Primitive : Primitives)
+			LaserSubsystem->InvalidateComponent(Primitive);
+	}
 
-		bool bIsCapsuleComponent = FName(TEXT("Pawn")) == OtherComp->GetCollisionProfileName();
-		if (bIsCapsuleComponent)
-			OtherComp->SetCollisionProfileName(FName(TEXT("PortalPawn")));
+	// Out of the way of new placements while hidden
+	if (APortalWall* PortalWall = GetPortalWall())
+	{
+		if (bHidden)
+			PortalWall->RemovePortal(this);
+		else if (HasActorBegunPlay())
+			PortalWall->AddPortal(this);
 	}
-	else
+}
+
+void APortal::SetPlacement(APortalWall* Wall, APlayerState* Player, bool bPortalA, uint8 PredictionId, const FVector& Location)
+{
+	const FVector WallLocation = Wall->GetActorTransform().InverseTransformPositionNoScale(Location);
+
+	Placement.Wall = Wall;
+	Placement.Player = Player;
+	Placement.WallY = (int16)FMath::Clamp(FMath::RoundToInt(WallLocation.Y), (int32)MIN_int16, (int32)MAX_int16);
+	Placement.WallZ = (int16)FMath::Clamp(FMath::RoundToInt(WallLocation.Z), (int32)MIN_int16, (int32)MAX_int16);
+	Placement.bPortalA = bPortalA;
+	Placement.PredictionId = PredictionId;
+
+	PortalA = bPortalA;
+	SetWallComponent(Cast<UPrimitiveComponent>(Wall->GetRootComponent()));
+}
+
+void APortal::OnRep_Placement()
+{
+	if (Placement.Wall == nullptr) return;
+
+	PortalA = Placement.bPortalA;
+	SetBorderMaterial();
+	SetWallComponent(Cast<UPrimitiveComponent>(Placement.Wall->GetRootComponent()));
+
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+		PortalSubsystem->OnPortalReplicated(this);
+}
+
+void APortal::UpdatePortalLink()
+{
+	if (LinkedPortal.IsValid() == false)
 	{
-		AGrabableActor* GrabableActor = Cast<AGrabableActor>(OtherActor);
-		if (GrabableActor)
-		{
-			OverlapedActors.AddUnique(GrabableActor);
-			bool bIsPhysicsActor = FName(TEXT("PhysicsActor")) == OtherComp->GetCollisionProfileName();
-			if (bIsPhysicsActor)
-				OtherComp->SetCollisionProfileName(FName(TEXT("PortalPhysicsActor")));
-		}
+		Link.Reset();
+		return;
 	}
-	
-	
+
+	// Built from the actor transforms so it does not matter whether Arrow was updated yet
+	Link.Update(Arrow->GetRelativeTransform() * GetActorTransform(), LinkedPortal->GetActorTransform());
+
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+		PortalSubsystem->MarkClonesDirty(this);
+}
+
+void APortal::OnPortalMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	UpdatePortalLink();
+
+	if (LinkedPortal.IsValid())
+		LinkedPortal->UpdatePortalLink();
+
+	if (APortalWall* PortalWall = GetPortalWall())
+		PortalWall->AddPortal(this);
+}
+
+void APortal::OnPortalBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	if (LinkedPortal.IsValid() == false)
+		return;
+
+	if (Cast<ATPSCharacter>(OtherActor) == nullptr && Cast<AGrabableActor>(OtherActor) == nullptr)
+		return;
+
+	// Where it was last frame
+	if (UPrimitiveComponent* Component = Cast<UPrimitiveComponent>(OtherActor->GetRootComponent()))
+		AddTransitBody(OtherActor, Component->GetComponentLocation() - Component->GetComponentVelocity() * GetWorld()->GetDeltaSeconds(), true);
 }
 
 void APortal::OnPortalEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
-	if (OverlapedCharacter == OtherActor)
-	{
-		bool bIsCapsuleComponent = FName(TEXT("PortalPawn")) == OtherComp->GetCollisionProfileName();
-		if (bIsCapsuleComponent)
-			OtherComp->SetCollisionProfileName(FName(TEXT("Pawn")));
+	FPortalTransitBody* Body = TransitBodies.FindByPredicate([OtherActor](const FPortalTransitBody& Body) { return Body.Actor == OtherActor; });
+	if (Body == nullptr)
+		return;
+
+	// It may have crossed on its way out, CollectTransits looks one last time and lets it collide with the wall again
+	if (OtherComp == Body->Component)
+		Body->bOverlapping = false;
+}
 
-		OverlapedCharacter.Reset();
+void APortal::AddTransitBody(AActor* Actor, const FVector& LastLocation, bool bOverlapping)
+{
+	UPrimitiveComponent* Component = Cast<UPrimitiveComponent>(Actor->GetRootComponent());
+	if (Component == nullptr)
+		return;
+
+	FPortalTransitBody* Body = TransitBodies.FindByPredicate([Actor](const FPortalTransitBody& Body) { return Body.Actor == Actor; });
+	if (Body)
+	{
+		Body->bOverlapping |= bOverlapping;
+		return;
 	}
-	else
+
+	// Later checks sweep from where the previous one saw it
+	FPortalTransitBody& NewBody = TransitBodies.AddDefaulted_GetRef();
+	NewBody.Actor = Actor;
+	NewBody.Component = Component;
+	NewBody.LastLocation = LastLocation;
+	NewBody.bOverlapping = bOverlapping;
+	NewBody.bOwnTransit = Actor->FindComponentByClass<UPortalCharacterMovementComponent>() != nullptr;
+
+	SetWallIgnored(NewBody, true);
+	Component->OnComponentPhysicsStateChanged.AddUniqueDynamic(this, &APortal::OnPhysicsStateChanged);
+
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+		PortalSubsystem->AddClone(this, Actor);
+}
+
+void APortal::RemoveTransitBody(int32 Index)
+{
+	FPortalTransitBody& Body = TransitBodies[Index];
+	SetWallIgnored(Body, false);
+
+	if (Body.Component.IsValid())
+		Body.Component->OnComponentPhysicsStateChanged.RemoveDynamic(this, &APortal::OnPhysicsStateChanged);
+
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+		PortalSubsystem->RemoveClone(this, Body.Actor.Get());
+
+	TransitBodies.RemoveAtSwap(Index);
+}
+
+void APortal::SetWallIgnored(FPortalTransitBody& Body, bool bIgnore)
+{
+	UPrimitiveComponent* Component = Body.Component.Get();
+	FPortalCollisionFilter& Filter = FPortalCollisionFilter::Get();
+
+	if (bIgnore)
 	{
-		AGrabableActor* GrabableActor = Cast<AGrabableActor>(OtherActor);
-		if (OverlapedActors.Remove(GrabableActor) != 0)
-			OtherComp->SetCollisionProfileName(FName(TEXT("PhysicsActor")));
+		if (WallComponent.IsValid() == false || Component == nullptr || Body.WallPair.Key)
+			return;
+
+		Body.WallPair = Filter.AddIgnored(Component, WallComponent.Get());
+		Component->IgnoreComponentWhenMoving(WallComponent.Get(), true);
+		return;
 	}
+
+	if (Body.WallPair.Key == nullptr)
+		return;
+
+	// Released by the pair it was given, the body instances may have changed since.
+	// Counted, another portal on the same wall may still let it through
+	const bool bIgnored = Filter.RemoveIgnored(Body.WallPair);
+	Body.WallPair = FPortalCollisionFilter::FBodyPair(nullptr, nullptr);
+
+	if (Component && WallComponent.IsValid())
+		Component->IgnoreComponentWhenMoving(WallComponent.Get(), bIgnored);
 }
 
-void APortal::OnPlaneBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void APortal::OnPhysicsStateChanged(UPrimitiveComponent* ChangedComponent, EComponentPhysicsStateChange StateChange)
 {
-	if (LinkedPortal.IsValid() == false)
+	if (StateChange != EComponentPhysicsStateChange::Destroyed)
 		return;
 
-	AMirrorCube* MirrorCube = Cast<AMirrorCube>(OtherActor);
-	if (MirrorCube)
-		MirrorCube->SetPortal(this);
+	FPortalCollisionFilter::Get().RemoveBody(ChangedComponent->GetBodyInstance());
+
+	for (int32 i = TransitBodies.Num() - 1; i >= 0; --i)
+	{
+		if (TransitBodies[i].Component == ChangedComponent)
+			RemoveTransitBody(i);
+		else if (WallComponent == ChangedComponent)
+			TransitBodies[i].WallPair = FPortalCollisionFilter::FBodyPair(nullptr, nullptr);
+	}
 }
 
-void APortal::OnPlaneEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void APortal::SetWallComponent(UPrimitiveComponent* Wall)
 {
-	AMirrorCube* MirrorCube = Cast<AMirrorCube>(OtherActor);
-	if (MirrorCube)
-		MirrorCube->ResetPortal();
+	for (FPortalTransitBody& Body : TransitBodies)
+		SetWallIgnored(Body, false);
+
+	if (WallComponent.IsValid())
+		WallComponent->OnComponentPhysicsStateChanged.RemoveDynamic(this, &APortal::OnPhysicsStateChanged);
+
+	// Before BeginPlay the portal is added to its wall there
+	APortalWall* PortalWall = HasActorBegunPlay() ? GetPortalWall() : nullptr;
+	if (PortalWall)
+		PortalWall->RemovePortal(this);
+
+	WallComponent = Wall;
+
+	if (Wall)
+		Wall->OnComponentPhysicsStateChanged.AddUniqueDynamic(this, &APortal::OnPhysicsStateChanged);
+
+	for (FPortalTransitBody& Body : TransitBodies)
+		SetWallIgnored(Body, true);
+
+	PortalWall = HasActorBegunPlay() ? GetPortalWall() : nullptr;
+	if (PortalWall)
+		PortalWall->AddPortal(this);
 }
 
-void APortal::OnChangePortalQulity(float quality)
+APortalWall* APortal::GetPortalWall() const
 {
-	FVector2D viewportSize;
-	GetWorld()->GetGameViewport()->GetViewportSize(viewportSize);
-	SceneCapture->TextureTarget->ResizeTarget(viewportSize.X * quality, viewportSize.Y * quality);
+	return WallComponent.IsValid() ? Cast<APortalWall>(WallComponent->GetOwner()) : nullptr;
 }
 
 void APortal::SetPortalMaterial()
 {
 	if (LinkedPortal.IsValid())
 	{
-		if (PortalA && MI_PortalBodyA)
-			PortalBody->SetMaterial(0, MI_PortalBodyA);
-		else if (MI_PortalBodyB)
-			PortalBody->SetMaterial(0, MI_PortalBodyB);
+		if (PortalBodyMaterial == nullptr)
+		{
+			UMaterialInterface* BodyMaterial = PortalA ? MI_PortalBodyA : MI_PortalBodyB;
+			if (BodyMaterial)
+			{
+				PortalBodyMaterial = UMaterialInstanceDynamic::Create(BodyMaterial, this);
+				if (ViewTarget)
+					PortalBodyMaterial->SetTextureParameterValue(RenderTargetParameter, ViewTarget);
+			}
+		}
+
+		if (PortalBodyMaterial)
+			PortalBody->SetMaterial(0, PortalBodyMaterial);
 	}
 	else if (MI_PortalBodyDefault)
 		PortalBody->SetMaterial(0, MI_PortalBodyDefault);
@@ -214,88 +419,217 @@ void APortal::ResetPortalMaterial()
 {
 	if (MI_PortalBodyDefault)
 		PortalBody->SetMaterial(0, MI_PortalBodyDefault);
+
+	Link.Reset();
+
+	// Nothing is captured for an unlinked portal, its target goes back to the pool
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+		PortalSubsystem->ReleaseRenderTarget(ViewTarget);
+	SetViewTarget(nullptr);
 }
 
-void APortal::SetCameraPosition()
+void APortal::SetCameraPosition(const FVector& ViewLocation, const FQuat& ViewRotation)
 {
 	if (LinkedPortal.IsValid())
 	{
-		FVector RelativeCameraLocation = Arrow->GetComponentTransform().InverseTransformPositionNoScale(Character->FPSCamera->GetComponentLocation());
-		LinkedPortal->SceneCapture->SetRelativeLocation(RelativeCameraLocation);
-
-		FRotator CameraRotator = Character->FPSCamera->GetComponentRotation();
-		FQuat Quat = FQuat(CameraRotator);
-		FRotator RelativeCameraRotator = Arrow->GetComponentTransform().InverseTransformRotation(Quat).Rotator();
-		LinkedPortal->SceneCapture->SetRelativeRotation(RelativeCameraRotator);
+		FVector CaptureLocation = Link.TransformPosition(ViewLocation);
+		FQuat CaptureQuat = Link.TransformRotation(ViewRotation);
+		LinkedPortal->SceneCapture->SetWorldLocationAndRotation(CaptureLocation, CaptureQuat);
 
-		LinkedPortal->SceneCapture->CustomNearClippingPlane = FVector::Dist(GetActorLocation(), Character->FPSCamera->GetComponentLocation()) - 20.f;
+		LinkedPortal->SceneCapture->CustomNearClippingPlane = FVector::Dist(GetActorLocation(), ViewLocation) - 20.f;
 	}
 }
 
-void APortal::CheckPlayerTeleport()
+void APortal::CapturePortalView(const FVector& ViewLocation, const FQuat& ViewRotation)
 {
-	if (OverlapedCharacter.IsValid())
-	{
-		FVector velocity = OverlapedCharacter->GetCharacterMovement()->Velocity;
-		FVector nextTickLocation = velocity * GetWorld()->GetDeltaSeconds() + OverlapedCharacter->GetActorLocation();
-		FVector portalLocation = GetActorLocation();
+	if (LinkedPortal.IsValid() == false || ViewTarget == nullptr) return;
 
-		float DotOfPortalAndNextTickLocation = FVector::DotProduct(GetActorForwardVector(), nextTickLocation - portalLocation);
-		if (DotOfPortalAndNextTickLocation < 0)
-		{
-			FVector RelativeVelocity = Arrow->GetComponentTransform().InverseTransformVector(velocity);
-			if (RelativeVelocity.Size() < 300)
-			{
-				RelativeVelocity = RelativeVelocity.GetSafeNormal();
-				RelativeVelocity *= 500.f;
-			}
-			OverlapedCharacter->GetMovementComponent()->Velocity = LinkedPortal->GetTransform().TransformVector(RelativeVelocity);
+	SetCameraPosition(ViewLocation, ViewRotation);
+	LinkedPortal->SceneCapture->TextureTarget = ViewTarget;
+	LinkedPortal->SceneCapture->CaptureScene();
+}
+
+void APortal::SetViewTarget(UTextureRenderTarget2D* RenderTarget)
+{
+	ViewTarget = RenderTarget;
+
+	if (PortalBodyMaterial == nullptr) return;
+
+	if (ViewTarget)
+		PortalBodyMaterial->SetTextureParameterValue(RenderTargetParameter, ViewTarget);
+	else
+		PortalBodyMaterial->ClearParameterValues();
+}
+
+const FBoxSphereBounds& APortal::GetPortalBounds() const
+{
+	return PortalBody->Bounds;
+}
+
+bool APortal::IntersectOpening(const FVector& Start, const FVector& End, float& OutTime) const
+{
+	const FTransform& PlaneTransform = PortalPlane->GetComponentTransform();
+	const FVector LocalStart = PlaneTransform.InverseTransformPositionNoScale(Start);
+	const FVector LocalEnd = PlaneTransform.InverseTransformPositionNoScale(End);
+
+	// Only from the front, out of the back is leaving the linked portal
+	if (LocalStart.X <= 0.f || LocalEnd.X > 0.f) return false;
+
+	const float Time = LocalStart.X / (LocalStart.X - LocalEnd.X);
+	const FVector LocalCross = FMath::Lerp(LocalStart, LocalEnd, Time);
+
+	const FVector Extent = PortalPlane->GetScaledBoxExtent();
+	if (FMath::Abs(LocalCross.Y) > Extent.Y || FMath::Abs(LocalCross.Z) > Extent.Z) return false;
+
+	OutTime = Time;
+	return true;
+}
+
+float APortal::GetLastRenderTimeOnScreen() const
+{
+	return PortalBody->GetLastRenderTimeOnScreen();
+}
+
+void APortal::AddSweptBody(AActor* Actor, float DeltaTime)
+{
+	if (LinkedPortal.IsValid() == false)
+		return;
+
+	UPrimitiveComponent* Component = Cast<UPrimitiveComponent>(Actor->GetRootComponent());
+	if (Component == nullptr)
+		return;
+
+	const FVector Velocity = Component->GetComponentVelocity();
+	if (Velocity.IsNearlyZero())
+		return;
 
-			FRotator Rot = LinkedPortal->GetActorRotation() - GetActorRotation();
-			OverlapedCharacter->AddControllerYawInput((Rot.Yaw + 180.f) * 0.4f);
+	// The portal bounds grown by this step's travel and the body's size
+	const FBoxSphereBounds& Bounds = GetPortalBounds();
+	const FVector Start = Component->GetComponentLocation();
+	const float Reach = Velocity.Size() * DeltaTime + Component->Bounds.SphereRadius;
+	if (FVector::DistSquared(Start, Bounds.Origin) > FMath::Square(Bounds.SphereRadius + Reach))
+		return;
 
-			FVector relativeTPLocation = Arrow->GetComponentTransform().InverseTransformPositionNoScale(nextTickLocation);
-			FVector TPLocation = LinkedPortal->GetTransform().TransformPositionNoScale(relativeTPLocation);
-			OverlapedCharacter->SetActorLocation(TPLocation);
+	// Its front reaching the wall is enough, the wall has to be ignored before the contact
+	const FVector End = Start + Velocity.GetSafeNormal() * Reach;
+	float CrossTime;
+	if (IntersectOpening(Start, End, CrossTime) == false)
+		return;
 
-			if (SC_PortalEnter)
-				UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_PortalEnter, LinkedPortal->GetActorLocation());
+	// Dropped after the next check unless it overlaps the volume by then
+	AddTransitBody(Actor, Start, false);
+}
+
+void APortal::CollectTransits(TArray<FPortalTransit>& OutTransits)
+{
+	if (LinkedPortal.IsValid() == false)
+		return;
+
+	for (int32 i = TransitBodies.Num() - 1; i >= 0; --i)
+	{
+		FPortalTransitBody& Body = TransitBodies[i];
+		if (Body.Actor.IsValid() == false || Body.Component.IsValid() == false)
+		{
+			RemoveTransitBody(i);
+			continue;
 		}
+
+		// The whole path since the last check against the opening, however fast the body is.
+		// Replicated bodies are moved by the server, a client keeps letting them through the wall until it does
+		const FVector Location = Body.Component->GetComponentLocation();
+		float CrossTime;
+		const bool bCrossed = Body.bOwnTransit == false && Body.Actor->GetLocalRole() == ROLE_Authority && IntersectOpening(Body.LastLocation, Location, CrossTime);
+		if (bCrossed)
+		{
+			FPortalTransit& Transit = OutTransits.AddDefaulted_GetRef();
+			Transit.Portal = this;
+			Transit.Actor = Body.Actor;
+			Transit.CrossPoint = FMath::Lerp(Body.LastLocation, Location, CrossTime);
+			Transit.CrossTime = CrossTime;
+			Transit.ExitLocation = Location;
+		}
+		Body.LastLocation = Location;
+
+		if (bCrossed || Body.bOverlapping == false)
+			RemoveTransitBody(i);
 	}
 }
 
-void APortal::CheckActorTeleport()
+void APortal::TeleportBody(AActor* Actor, const FVector& CrossPoint)
+{
+	if (LinkedPortal.IsValid() == false)
+		return;
+
+	if (AGrabableActor* GrabableActor = Cast<AGrabableActor>(Actor))
+		TeleportActor(GrabableActor, CrossPoint);
+}
+
+void APortal::MoveThroughPortal(AActor* Actor, const FVector& CrossPoint)
+{
+	// Split at the crossing: up to it happened on this side, the rest is swept out of the linked portal
+	// so a fast body cannot end up inside whatever is in front of it. Entering the linked portal's
+	// volume on the first move already lets the body through the wall around it
+	const FVector ExitLocation = Link.TransformPosition(CrossPoint);
+	const FVector TPLocation = Link.TransformPosition(Actor->GetActorLocation());
+
+	Actor->SetActorLocation(ExitLocation, false, nullptr, ETeleportType::TeleportPhysics);
+	Actor->SetActorLocation(TPLocation, true);
+}
+
+void APortal::OnCharacterTransit(ACharacter* Pawn, const FVector& CrossPoint)
 {
-	for (AGrabableActor* OverlapedActor : OverlapedActors)
+	if (LinkedPortal.IsValid() == false)
+		return;
+
+	if (Pawn->HasAuthority())
 	{
-		FVector velocity = OverlapedActor->GetVelocity();
-		FVector nextTickLocation = velocity * GetWorld()->GetDeltaSeconds() + OverlapedActor->GetActorLocation();
-		FVector portalLocation = GetActorLocation();
+		if (ATPSCharacter* TPSCharacter = Cast<ATPSCharacter>(Pawn))
+			TPSCharacter->OnPortalTransit();
+	}
 
-		float DotOfPortalAndNextTickLocation = FVector::DotProduct(GetActorForwardVector(), nextTickLocation - portalLocation);
-		if (DotOfPortalAndNextTickLocation < 0)
-		{
-			FVector RelativeVelocity = Arrow->GetComponentTransform().InverseTransformVectorNoScale(velocity);
-			velocity = LinkedPortal->GetTransform().TransformVectorNoScale(RelativeVelocity);
-			if (velocity.Size() < 300)
-			{
-				velocity = velocity.GetSafeNormal();
-				velocity *= 300.f;
-			}
-			OverlapedActor->SetVelocity(velocity);
+	if (UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>())
+		PortalSubsystem->AddMovementTransit(this, Pawn, CrossPoint);
 
-			FRotator OverlapedActorRot = OverlapedActor->GetActorRotation();
-			FQuat Quat = FQuat(OverlapedActorRot);
-			FQuat RelativeQuat = Arrow->GetComponentTransform().InverseTransformRotation(Quat);
-			FRotator Rotator = LinkedPortal->GetTransform().TransformRotation(RelativeQuat).Rotator();
-			OverlapedActor->SetActorRelativeRotation(Rotator);
+	if (SC_PortalEnter)
+		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_PortalEnter, LinkedPortal->GetActorLocation());
+}
 
-			FVector relativeTPLocation = Arrow->GetComponentTransform().InverseTransformPositionNoScale(nextTickLocation);
-			FVector TPLocation = LinkedPortal->GetTransform().TransformPositionNoScale(relativeTPLocation);
-			OverlapedActor->SetActorLocation(TPLocation);
+bool APortal::IsPredicted() const
+{
+	// Spawned by the client itself instead of replicated from the server
+	return GetNetMode() == NM_Client && GetLocalRole() == ROLE_Authority;
+}
 
-			return;
-		}
+void APortal::TeleportActor(AGrabableActor* GrabableActor, const FVector& CrossPoint)
+{
+	FVector velocity = Link.TransformVector(GrabableActor->GetVelocity());
+	if (velocity.Size() < 300)
+	{
+		velocity = velocity.GetSafeNormal();
+		velocity *= 300.f;
 	}
+
+	FRotator Rotator = Link.TransformRotation(GrabableActor->GetActorQuat()).Rotator();
+	GrabableActor->SetActorRelativeRotation(Rotator);
+
+	MoveThroughPortal(GrabableActor, CrossPoint);
+
+	GrabableActor->SetVelocity(velocity);
+}
+
+ELaserResponse APortal::GetLaserResponse(const UPrimitiveComponent* Component) const
+{
+	return ELaserResponse::PORTAL;
 }
 
+void APortal::GetLaserExits(const FHitResult& HitResult, const FVector& Direction, FLaserExits& OutExits) const
+{
+	if (LinkedPortal.IsValid() == false) return;
+
+	FLaserExit& Exit = OutExits.AddDefaulted_GetRef();
+
+	Exit.Start = Link.TransformPosition(HitResult.ImpactPoint);
+	Exit.Direction = Link.TransformVector(Direction);
+
+	Exit.LinkedComponent = LinkedPortal->GetRootComponent();
+}
@@ -4,10 +4,61 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "LaserInteractable.h"
+#include "PortalLink.h"
+#include "PortalCollisionFilter.h"
 #include "Portal.generated.h"
 
+DECLARE_MULTICAST_DELEGATE_OneParam(FPortalLinkDelegate, class APortal*)
+
+// Where a player's portal is, replicated once instead of the actor's movement
+USTRUCT()
+struct FPortalPlacement
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class APortalWall* Wall = nullptr;
+
+	UPROPERTY()
+	class APlayerState* Player = nullptr;
+
+	// Position on the wall in its local Y and Z, whole centimeters
+	UPROPERTY()
+	int16 WallY = 0;
+
+	UPROPERTY()
+	int16 WallZ = 0;
+
+	UPROPERTY()
+	bool bPortalA = false;
+
+	// Client prediction this placement answers, 0 when none
+	UPROPERTY()
+	uint8 PredictionId = 0;
+};
+
+// A character or grabable actor in the portal volume. Its location is kept from check to check
+// so a crossing is swept over the path it really took instead of predicted from its velocity
+struct FPortalTransitBody
+{
+	TWeakObjectPtr<AActor> Actor;
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+	FVector LastLocation;
+
+	// Cleared on end overlap and false for a body added ahead by AddSweptBody,
+	// the body is checked one last time before it is dropped
+	bool bOverlapping;
+
+	// Goes through in its own move, see UPortalCharacterMovementComponent
+	bool bOwnTransit;
+
+	// Its pair with the wall in FPortalCollisionFilter, both null while the wall is not ignored
+	FPortalCollisionFilter::FBodyPair WallPair = FPortalCollisionFilter::FBodyPair(nullptr, nullptr);
+};
+
 UCLASS()
-class TPS_API APortal : public AActor
+class TPS_API APortal : public AActor, public ILaserInteractable
 {
 	GENERATED_BODY()
 	
@@ -17,16 +68,27 @@ public:
 
 	void LinkPortal(TWeakObjectPtr<APortal> LinkPortal);
 
+	// Links only this side, nullptr unlinks
+	void SetLinkedPortal(APortal* Portal);
+
+	// Hidden while a client's predicted portal stands in for it
+	void SetPortalHidden(bool bHidden);
+
+	// Set before FinishSpawning by UPortalSubsystem
+	void SetPlacement(class APortalWall* Wall, class APlayerState* Player, bool bPortalA, uint8 PredictionId, const FVector& Location);
+	const FPortalPlacement& GetPlacement() const { return Placement; }
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Wall the portal was shot on, bodies in the portal pass through it
+	void SetWallComponent(UPrimitiveComponent* Wall);
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason);
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 private:
 
 	virtual void OnConstruction(const FTransform& Transform) override;
@@ -37,25 +99,74 @@ private:
 	UFUNCTION()
 	void OnPortalEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 
-	UFUNCTION()
-	void OnPlaneBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	void SetPortalMaterial();
+	void SetBorderMaterial();
 
 	UFUNCTION()
-	void OnPlaneEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+	void OnRep_Placement();
+
+	void OnPortalMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	// Also shows a clone of Actor at the linked portal while it is in the volume.
+	// LastLocation is where its next crossing check sweeps from
+	void AddTransitBody(AActor* Actor, const FVector& LastLocation, bool bOverlapping);
+	void RemoveTransitBody(int32 Index);
+
+	void SetWallIgnored(FPortalTransitBody& Body, bool bIgnore);
 
+	// A destroyed body instance may be reused by another body, its pairs with the wall go first
 	UFUNCTION()
-	void OnChangePortalQulity(float quality);
+	void OnPhysicsStateChanged(UPrimitiveComponent* ChangedComponent, EComponentPhysicsStateChange StateChange);
 
-	void SetPortalMaterial();
+	// The APortalWall WallComponent belongs to, if any
+	class APortalWall* GetPortalWall() const;
+
+	void MoveThroughPortal(AActor* Actor, const FVector& CrossPoint);
+	void TeleportActor(class AGrabableActor* GrabableActor, const FVector& CrossPoint);
 
 public:
 
 	void ResetPortalMaterial();
 
-	void SetCameraPosition();
+	// From this portal's side into the linked portal's, only valid while LinkedPortal is
+	const FPortalLink& GetPortalLink() const { return Link; }
+	void UpdatePortalLink();
+
+	// Places the linked portal's capture where a camera at ViewLocation looks through this portal from
+	void SetCameraPosition(const FVector& ViewLocation, const FQuat& ViewRotation);
+
+	// Renders the view through this portal into the linked portal's capture, called by UPortalSubsystem
+	void CapturePortalView(const FVector& ViewLocation, const FQuat& ViewRotation);
+
+	const FBoxSphereBounds& GetPortalBounds() const;
+
+	// Where Start to End goes through the opening from the front, as a fraction of the segment
+	bool IntersectOpening(const FVector& Start, const FVector& End, float& OutTime) const;
+	float GetLastRenderTimeOnScreen() const;
+
+	// Target the linked portal captures into and this portal's body shows, drawn from UPortalSubsystem's pool
+	void SetViewTarget(class UTextureRenderTarget2D* RenderTarget);
+	class UTextureRenderTarget2D* GetViewTarget() const { return ViewTarget; }
+
+	// Adds Actor before physics if its path this step reaches the opening, a fast body may pass the volume
+	// without ever overlapping it and would hit the wall. Called by UPortalSubsystem
+	void AddSweptBody(AActor* Actor, float DeltaTime);
+
+	// Adds every body whose path since the last check went into the opening. Called by UPortalSubsystem after physics
+	void CollectTransits(TArray<struct FPortalTransit>& OutTransits);
+
+	// Moves Actor out of the linked portal, CrossPoint is where it went into this one
+	void TeleportBody(AActor* Actor, const FVector& CrossPoint);
+
+	// Pawn went through this portal in its own move
+	void OnCharacterTransit(class ACharacter* Pawn, const FVector& CrossPoint);
 
-	void CheckPlayerTeleport();
-	void CheckActorTeleport();
+	// A client's local guess, see UPortalSubsystem::PredictPlayerPortal
+	bool IsPredicted() const;
+
+	// ILaserInteractable
+	virtual ELaserResponse GetLaserResponse(const UPrimitiveComponent* Component) const override;
+	virtual void GetLaserExits(const FHitResult& HitResult, const FVector& Direction, FLaserExits& OutExits) const override;
 
 	bool PortalA;
 
@@ -90,15 +201,15 @@ private:
 	class UMaterialInterface* MI_PortalBodyDefault;
 
 
-	UPROPERTY(VisibleInstanceOnly)
-	TWeakObjectPtr<class ATPSCharacter> Character;
-
-
+	// Texture parameter of MI_PortalBodyA / MI_PortalBodyB that shows the view through the portal
 	UPROPERTY(EditDefaultsOnly)
-	class UTextureRenderTarget2D* RenderTargetA;
+	FName RenderTargetParameter;
 
-	UPROPERTY(EditDefaultsOnly)
-	class UTextureRenderTarget2D* RenderTargetB;
+	UPROPERTY()
+	class UMaterialInstanceDynamic* PortalBodyMaterial;
+
+	UPROPERTY(VisibleInstanceOnly)
+	class UTextureRenderTarget2D* ViewTarget;
 
 	UPROPERTY(EditDefaultsOnly)
 	class USceneCaptureComponent2D* SceneCapture;
@@ -108,17 +219,15 @@ private:
 
 
 
-	UPROPERTY(VisibleAnywhere)
-	TArray<class AGrabableActor*> OverlapedActors;
-
-	UPROPERTY(VisibleAnywhere)
-	TWeakObjectPtr<class ATPSCharacter> OverlapedCharacter;
+	FPortalLink Link;
 
+	TArray<FPortalTransitBody> TransitBodies;
 
-	UPROPERTY()
-	class UPortalGameInstance* GameInstance;
+	UPROPERTY(VisibleInstanceOnly)
+	TWeakObjectPtr<UPrimitiveComponent> WallComponent;
 
-	FDelegateHandle PortalQualityDelegateHandle;
+	UPROPERTY(ReplicatedUsing = OnRep_Placement)
+	FPortalPlacement Placement;
 
 public:
 
@@ -127,4 +236,7 @@ public:
 
 	UPROPERTY(VisibleAnywhere)
 	class UArrowComponent* Arrow;
+
+	// Broadcast when this portal is linked or goes away
+	FPortalLinkDelegate OnPortalLinkChanged;
 };
\ No newline at end of file
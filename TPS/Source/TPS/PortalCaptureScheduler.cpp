@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PortalCaptureScheduler.h"
+#include "SceneManagement.h"
+#include "Math/InverseRotationMatrix.h"
+#include "Math/PerspectiveMatrix.h"
+
+void FPortalCaptureScheduler::Schedule(const FPortalCaptureSettings& Settings, TArrayView<const FPortalCaptureView> Views, TArrayView<const FPortalCaptureCandidate> Candidates, TArray<int32>& OutCaptures, FPortalCaptureStats& OutStats)
+{
+	OutCaptures.Reset();
+	OutStats = FPortalCaptureStats();
+
+	TArray<TPair<float, int32>, TInlineAllocator<16>> Visible;
+	TArray<int32, TInlineAllocator<16>> Waiting;
+
+	for (int32 i = 0; i < Candidates.Num(); ++i)
+	{
+		const FPortalCaptureCandidate& Candidate = Candidates[i];
+
+		bool bInFrustum = false;
+		float DistSquared = MAX_flt;
+		for (const FPortalCaptureView& View : Views)
+		{
+			if (View.Frustum.IntersectSphere(Candidate.Location, Candidate.Radius) == false) continue;
+
+			bInFrustum = true;
+			DistSquared = FMath::Min(DistSquared, FVector::DistSquared(View.Location, Candidate.Location));
+		}
+
+		if (bInFrustum == false)
+		{
+			++OutStats.SkippedFrustum;
+			continue;
+		}
+
+		const float MaxDistance = Settings.MaxCaptureDistance + Candidate.Radius;
+		if (DistSquared > MaxDistance * MaxDistance)
+		{
+			++OutStats.SkippedDistance;
+			continue;
+		}
+
+		if (Candidate.bWasVisibleLastFrame)
+			Visible.Emplace(DistSquared, i);
+		else
+			Waiting.Add(i);
+	}
+
+	const int32 MaxCaptures = FMath::Max(0, Settings.MaxCapturesPerFrame);
+	const int32 RoundRobinSlots = FMath::Min(FMath::Max(0, Settings.RoundRobinCapturesPerFrame), Waiting.Num());
+
+	Visible.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; });
+
+	const int32 VisibleSlots = FMath::Max(0, MaxCaptures - RoundRobinSlots);
+	for (int32 i = 0; i < Visible.Num(); ++i)
+	{
+		if (i < VisibleSlots)
+			OutCaptures.Add(Visible[i].Value);
+		else
+			Waiting.Add(Visible[i].Value);
+	}
+
+	// Whatever budget is left goes round robin
+	Waiting.Sort([&Candidates](int32 A, int32 B)
+	{
+		if (Candidates[A].LastCaptureFrame != Candidates[B].LastCaptureFrame)
+			return Candidates[A].LastCaptureFrame < Candidates[B].LastCaptureFrame;
+		return A < B;
+	});
+
+	for (int32 Index : Waiting)
+	{
+		if (OutCaptures.Num() >= MaxCaptures)
+		{
+			++OutStats.SkippedBudget;
+			continue;
+		}
+
+		OutCaptures.Add(Index);
+		++OutStats.RoundRobin;
+	}
+
+	OutStats.Captured = OutCaptures.Num();
+}
+
+float FPortalCaptureScheduler::GetScreenSize(TArrayView<const FPortalCaptureView> Views, const FPortalCaptureCandidate& Candidate)
+{
+	float ScreenSize = 0.f;
+	for (const FPortalCaptureView& View : Views)
+		ScreenSize = FMath::Max(ScreenSize, ComputeBoundsScreenSize(Candidate.Location, Candidate.Radius, View.Location, View.ProjectionMatrix));
+	return ScreenSize;
+}
+
+float FPortalCaptureScheduler::SnapResolutionScale(TArrayView<const float> Scales, float ScreenSize)
+{
+	if (Scales.Num() == 0) return 1.f;
+
+	for (float Scale : Scales)
+	{
+		if (ScreenSize <= Scale)
+			return Scale;
+	}
+	return Scales.Last();
+}
+
+FIntPoint FPortalCaptureScheduler::GetCaptureSize(TArrayView<const FPortalCaptureView> Views, float Scale)
+{
+	FIntPoint ViewSize(0, 0);
+	for (const FPortalCaptureView& View : Views)
+		ViewSize = ViewSize.ComponentMax(View.ViewSize);
+
+	const int32 SizeX = FMath::Max(8, FMath::DivideAndRoundUp(FMath::CeilToInt(ViewSize.X * Scale), 8) * 8);
+	const int32 SizeY = FMath::Max(8, FMath::DivideAndRoundUp(FMath::CeilToInt(ViewSize.Y * Scale), 8) * 8);
+	return FIntPoint(SizeX, SizeY);
+}
+
+FPortalCaptureView FPortalCaptureScheduler::MakeView(const FVector& Location, const FRotator& Rotation, float FOV, FIntPoint ViewSize)
+{
+	// From Unreal's axes to the view's, X forward becomes Z
+	const FMatrix ViewMatrix = FTranslationMatrix(-Location) * FInverseRotationMatrix(Rotation) * FMatrix(
+		FPlane(0.f, 0.f, 1.f, 0.f),
+		FPlane(1.f, 0.f, 0.f, 0.f),
+		FPlane(0.f, 1.f, 0.f, 0.f),
+		FPlane(0.f, 0.f, 0.f, 1.f));
+
+	FPortalCaptureView View;
+	View.Location = Location;
+	View.Rotation = Rotation.Quaternion();
+	View.ViewSize = ViewSize;
+	View.ProjectionMatrix = FReversedZPerspectiveMatrix(FMath::DegreesToRadians(FOV * 0.5f), ViewSize.X, ViewSize.Y, GNearClippingPlane);
+	GetViewFrustumBounds(View.Frustum, ViewMatrix * View.ProjectionMatrix, false);
+	return View;
+}
@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ConvexVolume.h"
+
+// One player view the portals are seen from
+struct FPortalCaptureView
+{
+	FVector Location;
+	FQuat Rotation = FQuat::Identity;
+	FConvexVolume Frustum;
+	FMatrix ProjectionMatrix;
+	FIntPoint ViewSize;
+};
+
+// A linked portal that could refresh its capture this frame
+struct FPortalCaptureCandidate
+{
+	// Bounding sphere of the portal body
+	FVector Location;
+	float Radius = 0.f;
+
+	// The body was drawn on screen last frame, false when it was occluded or off screen
+	bool bWasVisibleLastFrame = false;
+
+	// Frame of the last capture, round robin refreshes the oldest first
+	uint64 LastCaptureFrame = 0;
+};
+
+struct FPortalCaptureSettings
+{
+	int32 MaxCapturesPerFrame = 2;
+
+	// Slots of MaxCapturesPerFrame kept for portals that were not visible last frame
+	int32 RoundRobinCapturesPerFrame = 1;
+
+	// Portals further than this from every view are never captured
+	float MaxCaptureDistance = 5000.f;
+};
+
+// What one Schedule call decided, every candidate ends up in exactly one of the counters
+struct FPortalCaptureStats
+{
+	int32 Captured = 0;
+	int32 RoundRobin = 0;
+	int32 SkippedFrustum = 0;
+	int32 SkippedDistance = 0;
+	int32 SkippedBudget = 0;
+
+	int32 GetSkipped() const { return SkippedFrustum + SkippedDistance + SkippedBudget; }
+};
+
+/**
+ * Picks which portal captures run this frame. Portals outside every view
+ * frustum or too far from every view are skipped. Portals that were on
+ * screen last frame come first, nearest first, up to MaxCapturesPerFrame.
+ * Portals that were not on screen, and visible ones that did not fit, share
+ * the round robin slots, the longest waiting first, so every portal in view
+ * is refreshed sooner or later.
+ * Only reads plain data so it can be run without a renderer.
+ */
+class TPS_API FPortalCaptureScheduler
+{
+public:
+
+	// Fills OutCaptures with indices into Candidates, in the order they should be captured
+	static void Schedule(const FPortalCaptureSettings& Settings, TArrayView<const FPortalCaptureView> Views, TArrayView<const FPortalCaptureCandidate> Candidates, TArray<int32>& OutCaptures, FPortalCaptureStats& OutStats);
+
+	// Largest projected diameter of the portal over all views, 1 spans the whole screen
+	static float GetScreenSize(TArrayView<const FPortalCaptureView> Views, const FPortalCaptureCandidate& Candidate);
+
+	// Smallest of the ascending Scales that covers ScreenSize, the largest when none does
+	static float SnapResolutionScale(TArrayView<const float> Scales, float ScreenSize);
+
+	// Render target size for a capture at Scale of the largest view, rounded up to a multiple of 8 so sizes pool well
+	static FIntPoint GetCaptureSize(TArrayView<const FPortalCaptureView> Views, float Scale);
+
+	// A view no viewport stands behind, FOV is horizontal in degrees
+	static FPortalCaptureView MakeView(const FVector& Location, const FRotator& Rotation, float FOV, FIntPoint ViewSize);
+};
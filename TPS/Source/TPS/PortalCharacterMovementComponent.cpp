@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PortalCharacterMovementComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/Controller.h"
+#include "Portal.h"
+#include "PortalSubsystem.h"
+
+UPortalCharacterMovementComponent::UPortalCharacterMovementComponent()
+{
+	MinExitSpeed = 300.f;
+	ExitSpeed = 500.f;
+	bPortalTransitThisMove = false;
+}
+
+FNetworkPredictionData_Client* UPortalCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UPortalCharacterMovementComponent* MutableThis = const_cast<UPortalCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_PortalCharacter(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UPortalCharacterMovementComponent::PerformMovement(float DeltaTime)
+{
+	bPortalTransitThisMove = false;
+
+	Super::PerformMovement(DeltaTime);
+}
+
+void UPortalCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
+{
+	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+
+	// Simulated proxies are only moved by replication
+	if (CharacterOwner == nullptr || CharacterOwner->GetLocalRole() == ROLE_SimulatedProxy) return;
+
+	TryPortalTransit(OldLocation);
+}
+
+bool UPortalCharacterMovementComponent::TryPortalTransit(const FVector& OldLocation)
+{
+	UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>();
+	if (PortalSubsystem == nullptr || UpdatedComponent == nullptr) return false;
+
+	const FVector NewLocation = UpdatedComponent->GetComponentLocation();
+
+	float CrossTime;
+	APortal* Portal = PortalSubsystem->FindPortalCrossing(OldLocation, NewLocation, CrossTime);
+
+	// The server does not know a predicted portal yet, going through it would only be corrected
+	if (Portal == nullptr || Portal->IsPredicted()) return false;
+
+	const FPortalLink& Link = Portal->GetPortalLink();
+	const FVector CrossPoint = FMath::Lerp(OldLocation, NewLocation, CrossTime);
+
+	// Upright on the other side, only the yaw goes through
+	const FRotator ExitRotation(0.f, Link.TransformRotation(UpdatedComponent->GetComponentQuat()).Rotator().Yaw, 0.f);
+
+	Velocity = Link.TransformVector(Velocity);
+	if (Velocity.Size() < MinExitSpeed)
+		Velocity = Velocity.GetSafeNormal() * ExitSpeed;
+
+	// Up to the crossing happened on this side, the rest is swept out of the linked portal
+	const FVector ExitLocation = Link.TransformPosition(CrossPoint);
+	UpdatedComponent->SetWorldLocationAndRotation(ExitLocation, ExitRotation, false, nullptr, ETeleportType::TeleportPhysics);
+
+	FHitResult Hit;
+	SafeMoveUpdatedComponent(Link.TransformPosition(NewLocation) - ExitLocation, ExitRotation, true, Hit);
+
+	bJustTeleported = true;
+	bPortalTransitThisMove = true;
+
+	// A replayed move turned the view and played the sound the first time
+	if (CharacterOwner->bClientUpdating) return true;
+
+	// Only where the view is driven, the server gets the turned rotation with the client's next moves
+	AController* Controller = CharacterOwner->GetController();
+	if (Controller && CharacterOwner->IsLocallyControlled())
+	{
+		FRotator ControlRotation = Link.TransformRotation(Controller->GetControlRotation().Quaternion()).Rotator();
+		ControlRotation.Roll = 0.f;
+		Controller->SetControlRotation(ControlRotation);
+	}
+
+	Portal->OnCharacterTransit(CharacterOwner, CrossPoint);
+	return true;
+}
+
+void FSavedMove_PortalCharacter::Clear()
+{
+	Super::Clear();
+
+	bPortalTransit = false;
+}
+
+void FSavedMove_PortalCharacter::PostUpdate(ACharacter* Character, EPostUpdateMode PostUpdateMode)
+{
+	Super::PostUpdate(Character, PostUpdateMode);
+
+	if (UPortalCharacterMovementComponent* MovementComponent = Cast<UPortalCharacterMovementComponent>(Character->GetCharacterMovement()))
+		bPortalTransit = MovementComponent->DidPortalTransit();
+}
+
+bool FSavedMove_PortalCharacter::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	// Combined, the move would start on one side and be replayed from there
+	if (bPortalTransit || static_cast<const FSavedMove_PortalCharacter*>(NewMove.Get())->bPortalTransit)
+		return false;
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+bool FSavedMove_PortalCharacter::IsImportantMove(const FSavedMovePtr& LastAckedMove) const
+{
+	return bPortalTransit || Super::IsImportantMove(LastAckedMove);
+}
+
+FNetworkPredictionData_Client_PortalCharacter::FNetworkPredictionData_Client_PortalCharacter(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_PortalCharacter::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_PortalCharacter());
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "PortalCharacterMovementComponent.generated.h"
+
+/**
+ * Character movement that goes through portals as part of the move.
+ * The crossing is found and applied inside PerformMovement, so a client
+ * predicts it, the server gets the same result running the client's move,
+ * and a client replaying its moves after a correction goes through again.
+ * Velocity, rotation and the view are turned by the portal link in the same
+ * step. Moves with a transit are never combined and are sent right away.
+ */
+UCLASS()
+class TPS_API UPortalCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UPortalCharacterMovementComponent();
+
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	// The move being performed went through a portal
+	bool DidPortalTransit() const { return bPortalTransitThisMove; }
+
+protected:
+
+	virtual void PerformMovement(float DeltaTime) override;
+
+	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
+
+private:
+
+	bool TryPortalTransit(const FVector& OldLocation);
+
+	// Slower than this out of a portal and the character is pushed out at ExitSpeed
+	UPROPERTY(EditDefaultsOnly, Category = "Portal")
+	float MinExitSpeed;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Portal")
+	float ExitSpeed;
+
+	bool bPortalTransitThisMove;
+};
+
+class FSavedMove_PortalCharacter : public FSavedMove_Character
+{
+public:
+
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override;
+	virtual void PostUpdate(ACharacter* Character, EPostUpdateMode PostUpdateMode) override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual bool IsImportantMove(const FSavedMovePtr& LastAckedMove) const override;
+
+	// The move went through a portal
+	bool bPortalTransit = false;
+};
+
+class FNetworkPredictionData_Client_PortalCharacter : public FNetworkPredictionData_Client_Character
+{
+public:
+
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_PortalCharacter(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PortalCollisionFilter.h"
+#include "Components/PrimitiveComponent.h"
+#include "PhysicsPublic.h"
+#if WITH_PHYSX
+#include "PhysXPublic.h"
+#endif
+
+#if WITH_PHYSX
+class FPortalContactModifyCallback : public FContactModifyCallback
+{
+public:
+
+	virtual void onContactModify(physx::PxContactModifyPair* const Pairs, physx::PxU32 Count) override
+	{
+		const FPortalCollisionFilter& Filter = FPortalCollisionFilter::Get();
+
+		for (physx::PxU32 i = 0; i < Count; ++i)
+		{
+			physx::PxContactModifyPair& Pair = Pairs[i];
+
+			const FBodyInstance* BodyA = FPhysxUserData::Get<FBodyInstance>(Pair.actor[0]->userData);
+			const FBodyInstance* BodyB = FPhysxUserData::Get<FBodyInstance>(Pair.actor[1]->userData);
+			if (Filter.IsIgnored(BodyA, BodyB) == false) continue;
+
+			for (physx::PxU32 j = 0; j < Pair.contacts.size(); ++j)
+				Pair.contacts.ignore(j);
+		}
+	}
+};
+
+class FPortalContactModifyCallbackFactory : public IContactModifyCallbackFactory
+{
+public:
+
+	virtual FContactModifyCallback* Create(FPhysScene* PhysScene) override
+	{
+		return new FPortalContactModifyCallback();
+	}
+
+	virtual void Destroy(FContactModifyCallback* Callback) override
+	{
+		delete Callback;
+	}
+};
+#endif
+
+FPortalCollisionFilter& FPortalCollisionFilter::Get()
+{
+	static FPortalCollisionFilter Filter;
+	return Filter;
+}
+
+void FPortalCollisionFilter::Register()
+{
+#if WITH_PHYSX
+	GContactModifyCallbackFactory = MakeShared<FPortalContactModifyCallbackFactory>();
+#endif
+}
+
+void FPortalCollisionFilter::Unregister()
+{
+#if WITH_PHYSX
+	GContactModifyCallbackFactory.Reset();
+#endif
+}
+
+FPortalCollisionFilter::FBodyPair FPortalCollisionFilter::MakePair(const FBodyInstance* BodyA, const FBodyInstance* BodyB)
+{
+	return BodyA < BodyB ? FBodyPair(BodyA, BodyB) : FBodyPair(BodyB, BodyA);
+}
+
+FPortalCollisionFilter::FBodyPair FPortalCollisionFilter::AddIgnored(UPrimitiveComponent* Body, UPrimitiveComponent* Other)
+{
+	if (Body == nullptr || Other == nullptr) return FBodyPair(nullptr, nullptr);
+
+	const FBodyPair Pair = MakePair(Body->GetBodyInstance(), Other->GetBodyInstance());
+
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+	++IgnoredPairs.FindOrAdd(Pair);
+	return Pair;
+}
+
+bool FPortalCollisionFilter::RemoveIgnored(const FBodyPair& Pair)
+{
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+
+	// Already dropped by RemoveBody
+	int32* Count = IgnoredPairs.Find(Pair);
+	if (Count == nullptr) return false;
+
+	if (--(*Count) > 0) return true;
+
+	IgnoredPairs.Remove(Pair);
+	return false;
+}
+
+void FPortalCollisionFilter::RemoveBody(const FBodyInstance* Body)
+{
+	if (Body == nullptr) return;
+
+	FRWScopeLock ScopeLock(Lock, SLT_Write);
+	for (auto It = IgnoredPairs.CreateIterator(); It; ++It)
+	{
+		if (It.Key().Key == Body || It.Key().Value == Body)
+			It.RemoveCurrent();
+	}
+}
+
+bool FPortalCollisionFilter::IsIgnored(const FBodyInstance* BodyA, const FBodyInstance* BodyB) const
+{
+	if (BodyA == nullptr || BodyB == nullptr) return false;
+
+	FRWScopeLock ScopeLock(Lock, SLT_ReadOnly);
+	return IgnoredPairs.Contains(MakePair(BodyA, BodyB));
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FBodyInstance;
+
+/**
+ * Pairs of bodies that must not collide while one of them passes through a
+ * portal, e.g. a cube and the wall the portal sits on. Movement sweeps skip
+ * the wall through IgnoreComponentWhenMoving, simulated bodies through a
+ * PhysX contact modify callback that drops the contacts of ignored pairs,
+ * so no collision profile or filter data is touched at runtime. Simulated
+ * bodies have to turn bContactModification on up front to reach the callback.
+ * Pairs are counted, a body in two portals on one wall stays ignored until
+ * it left both. Callers release the pair they were given, a body instance
+ * may be gone or reused by then. Read from the physics threads, written on
+ * the game thread.
+ */
+class TPS_API FPortalCollisionFilter
+{
+public:
+
+	typedef TPair<const FBodyInstance*, const FBodyInstance*> FBodyPair;
+
+	static FPortalCollisionFilter& Get();
+
+	// Ignores the pair until RemoveIgnored is called with the returned one
+	FBodyPair AddIgnored(UPrimitiveComponent* Body, UPrimitiveComponent* Other);
+
+	// Returns whether the pair is still ignored afterwards
+	bool RemoveIgnored(const FBodyPair& Pair);
+
+	// Drops every pair of Body whatever its count, for a body instance about to go away
+	void RemoveBody(const FBodyInstance* Body);
+
+	bool IsIgnored(const FBodyInstance* BodyA, const FBodyInstance* BodyB) const;
+
+	// Installs the contact modify callback, must run before the first physics scene is created
+	static void Register();
+	static void Unregister();
+
+private:
+
+	static FBodyPair MakePair(const FBodyInstance* BodyA, const FBodyInstance* BodyB);
+
+	TMap<FBodyPair, int32> IgnoredPairs;
+	mutable FRWLock Lock;
+};
@@ -23,7 +23,6 @@ UPortalGameInstance::UPortalGameInstance()
 void UPortalGameInstance::SetPortalQuality(float quality)
 {
 	PortalQuality = quality;
-	OnChangePortalQualityDelegate.Broadcast(PortalQuality);
 }
 
 void UPortalGameInstance::LoadMainMenu()
@@ -7,7 +7,6 @@
 #include "PortalGameInstance.generated.h"
 
 
-DECLARE_MULTICAST_DELEGATE_OneParam(FPortalQualityDelegate, float)
 /**
  * 
  */
@@ -50,8 +49,4 @@ private:
 
 	float PortalQuality;
 
-public:
-
-	FPortalQualityDelegate OnChangePortalQualityDelegate;
-
 };
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PortalLink.h"
+
+void FPortalLink::Update(const FTransform& SourceArrow, const FTransform& Destination)
+{
+	// Row vectors, the source inverse applies first
+	SourceToDestination = SourceArrow.ToMatrixNoScale().InverseFast() * Destination.ToMatrixNoScale();
+	DestinationToSource = SourceToDestination.InverseFast();
+	RotationDelta = Destination.GetRotation() * SourceArrow.GetRotation().Inverse();
+	RotationDelta.Normalize();
+
+	bValid = true;
+}
+
+void FPortalLink::Reset()
+{
+	SourceToDestination = FMatrix::Identity;
+	DestinationToSource = FMatrix::Identity;
+	RotationDelta = FQuat::Identity;
+
+	bValid = false;
+}
+
+FTransform FPortalLink::TransformTransform(const FTransform& Transform) const
+{
+	return FTransform(TransformRotation(Transform.GetRotation()), TransformPosition(Transform.GetLocation()), Transform.GetScale3D());
+}
+
+void FPortalLink::TransformPositions(TArrayView<FVector> Positions) const
+{
+	for (FVector& Position : Positions)
+		Position = SourceToDestination.TransformPosition(Position);
+}
+
+void FPortalLink::TransformVectors(TArrayView<FVector> Vectors) const
+{
+	for (FVector& Vector : Vectors)
+		Vector = SourceToDestination.TransformVector(Vector);
+}
+
+void FPortalLink::TransformRotations(TArrayView<FQuat> Rotations) const
+{
+	for (FQuat& Rotation : Rotations)
+		Rotation = RotationDelta * Rotation;
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Maps world space on one side of a portal pair to the other side: relative
+ * to the source portal's Arrow, then out of the destination portal. The
+ * matrices are built once when either portal moves or relinks, so the
+ * teleport, capture, clone and laser code just multiply.
+ * Scale is ignored, a portal always maps rigidly.
+ */
+struct TPS_API FPortalLink
+{
+	void Update(const FTransform& SourceArrow, const FTransform& Destination);
+	void Reset();
+
+	bool IsValid() const { return bValid; }
+
+	FVector TransformPosition(const FVector& Position) const { return SourceToDestination.TransformPosition(Position); }
+	FVector TransformVector(const FVector& Vector) const { return SourceToDestination.TransformVector(Vector); }
+	FQuat TransformRotation(const FQuat& Rotation) const { return RotationDelta * Rotation; }
+	FTransform TransformTransform(const FTransform& Transform) const;
+
+	FVector InverseTransformPosition(const FVector& Position) const { return DestinationToSource.TransformPosition(Position); }
+	FVector InverseTransformVector(const FVector& Vector) const { return DestinationToSource.TransformVector(Vector); }
+	FQuat InverseTransformRotation(const FQuat& Rotation) const { return RotationDelta.Inverse() * Rotation; }
+
+	// In place, for many points of one actor at once
+	void TransformPositions(TArrayView<FVector> Positions) const;
+	void TransformVectors(TArrayView<FVector> Vectors) const;
+	void TransformRotations(TArrayView<FQuat> Rotations) const;
+
+	const FMatrix& GetMatrix() const { return SourceToDestination; }
+	const FMatrix& GetInverseMatrix() const { return DestinationToSource; }
+
+private:
+
+	FMatrix SourceToDestination = FMatrix::Identity;
+	FMatrix DestinationToSource = FMatrix::Identity;
+	FQuat RotationDelta = FQuat::Identity;
+
+	bool bValid = false;
+};
@@ -0,0 +1,861 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PortalSubsystem.h"
+#include "Portal.h"
+#include "PortalWall.h"
+#include "GrabableActor.h"
+#include "TPSCharacter.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerState.h"
+#include "PortalGameInstance.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/GameViewportClient.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
+#include "SceneView.h"
+#include "SceneManagement.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Portal Capture"), STAT_PortalCapture, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal Captures"), STAT_PortalCaptures, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal Captures Skipped"), STAT_PortalCapturesSkipped, STATGROUP_Game);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Portal Render Targets"), STAT_PortalRenderTargets, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Portal Trace"), STAT_PortalTrace, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal Trace Cache Hits"), STAT_PortalTraceCacheHits, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal Clones Moved"), STAT_PortalClonesMoved, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Portal Transit"), STAT_PortalTransit, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Portal Transits"), STAT_PortalTransits, STATGROUP_Game);
+
+void FPortalSweepTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem && TickType != LEVELTICK_ViewportsOnly)
+		Subsystem->AddSweptBodies(DeltaTime);
+}
+
+FString FPortalSweepTickFunction::DiagnosticMessage()
+{
+	return TEXT("UPortalSubsystem::AddSweptBodies");
+}
+
+void FPortalTransitTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Subsystem && TickType != LEVELTICK_ViewportsOnly)
+		Subsystem->ResolveTransits();
+}
+
+FString FPortalTransitTickFunction::DiagnosticMessage()
+{
+	return TEXT("UPortalSubsystem::ResolveTransits");
+}
+
+UPortalSubsystem::UPortalSubsystem()
+{
+	MaxCapturesPerFrame = 2;
+	RoundRobinCapturesPerFrame = 1;
+	MaxCaptureDistance = 5000.f;
+	VisibleTolerance = 0.1f;
+	ResolutionScales = { 0.25f, 0.5f, 1.f };
+	FreeRenderTargetFrames = 300;
+	RenderTargetNum = 0;
+	MaxTraceDepth = 4;
+	TraceCacheFrame = 0;
+	TraceCacheGeneration = 0;
+	TotalSkippedCaptures = 0;
+	LastTransitSeconds = 0.0;
+	LastCaptureSeconds = 0.0;
+	CloneHost = nullptr;
+	LastPredictionId = 0;
+}
+
+void UPortalSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// Before the physics step, so the walls are ignored before any contact
+	SweepTickFunction.Subsystem = this;
+	SweepTickFunction.TickGroup = TG_PrePhysics;
+	SweepTickFunction.bCanEverTick = true;
+	SweepTickFunction.bStartWithTickEnabled = true;
+	SweepTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+
+	// After character movement and the physics results, before the cameras update
+	TransitTickFunction.Subsystem = this;
+	TransitTickFunction.TickGroup = TG_PostPhysics;
+	TransitTickFunction.bCanEverTick = true;
+	TransitTickFunction.bStartWithTickEnabled = true;
+	TransitTickFunction.RegisterTickFunction(InWorld.PersistentLevel);
+
+	// The player camera managers update after the last tick group, this runs after them
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UPortalSubsystem::OnWorldPostActorTick);
+}
+
+void UPortalSubsystem::Deinitialize()
+{
+	if (SweepTickFunction.IsTickFunctionRegistered())
+		SweepTickFunction.UnRegisterTickFunction();
+	SweepTickFunction.Subsystem = nullptr;
+	if (TransitTickFunction.IsTickFunctionRegistered())
+		TransitTickFunction.UnRegisterTickFunction();
+	TransitTickFunction.Subsystem = nullptr;
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	Transits.Empty();
+	MovementTransits.Empty();
+
+	Portals.Empty();
+	PlayerPortals.Empty();
+	FreeRenderTargets.Empty();
+	TraceCache.Empty();
+	while (Clones.Num() > 0)
+		ReleaseClone(Clones.Num() - 1);
+	FreeStaticClones.Empty();
+	FreeSkeletalClones.Empty();
+	CloneHost = nullptr;
+	DEC_DWORD_STAT_BY(STAT_PortalRenderTargets, RenderTargetNum);
+	RenderTargetNum = 0;
+
+	Super::Deinitialize();
+}
+
+void UPortalSubsystem::Tick(float DeltaTime)
+{
+	// Before capturing so the captures show them where they are this frame
+	UpdateClones();
+}
+
+void UPortalSubsystem::OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaTime)
+{
+	if (InWorld != GetWorld() || TickType == LEVELTICK_ViewportsOnly || InWorld->IsPaused() || IsTickable() == false) return;
+
+	CapturePortals();
+}
+
+void UPortalSubsystem::CapturePortals()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalCapture);
+	const double StartTime = FPlatformTime::Seconds();
+
+	Portals.RemoveAll([](const FPortalCaptureEntry& Entry) { return Entry.Portal.IsValid() == false; });
+
+	TArray<FPortalCaptureView, TInlineAllocator<2>> Views;
+	GetViews(Views);
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	// Only linked portals show a capture
+	TArray<FPortalCaptureCandidate, TInlineAllocator<16>> Candidates;
+	TArray<int32, TInlineAllocator<16>> CandidateEntries;
+	for (int32 i = 0; i < Portals.Num(); ++i)
+	{
+		APortal* Portal = Portals[i].Portal.Get();
+		if (Portal->LinkedPortal.IsValid() == false) continue;
+
+		const FBoxSphereBounds& Bounds = Portal->GetPortalBounds();
+
+		FPortalCaptureCandidate& Candidate = Candidates.AddDefaulted_GetRef();
+		Candidate.Location = Bounds.Origin;
+		Candidate.Radius = Bounds.SphereRadius;
+		Candidate.bWasVisibleLastFrame = TimeSeconds - Portal->GetLastRenderTimeOnScreen() <= VisibleTolerance;
+		Candidate.LastCaptureFrame = Portals[i].LastCaptureFrame;
+		CandidateEntries.Add(i);
+	}
+
+	FPortalCaptureSettings Settings;
+	Settings.MaxCapturesPerFrame = MaxCapturesPerFrame;
+	Settings.RoundRobinCapturesPerFrame = RoundRobinCapturesPerFrame;
+	Settings.MaxCaptureDistance = MaxCaptureDistance;
+
+	TArray<int32> Captures;
+	FPortalCaptureScheduler::Schedule(Settings, Views, Candidates, Captures, LastCaptureStats);
+
+	const float Quality = GetPortalQuality();
+	for (int32 Index : Captures)
+	{
+		const float ScreenSize = FPortalCaptureScheduler::GetScreenSize(Views, Candidates[Index]);
+		const float Scale = FPortalCaptureScheduler::SnapResolutionScale(ResolutionScales, ScreenSize) * Quality;
+
+		// Split screen players share the capture, the closest one sees it right
+		const FPortalCaptureView* Nearest = nullptr;
+		for (const FPortalCaptureView& View : Views)
+		{
+			if (Nearest == nullptr || FVector::DistSquared(View.Location, Candidates[Index].Location) < FVector::DistSquared(Nearest->Location, Candidates[Index].Location))
+				Nearest = &View;
+		}
+		if (Nearest == nullptr) continue;
+
+		FPortalCaptureEntry& Entry = Portals[CandidateEntries[Index]];
+		UpdateViewTarget(Entry.Portal.Get(), FPortalCaptureScheduler::GetCaptureSize(Views, Scale));
+		Entry.Portal->CapturePortalView(Nearest->Location, Nearest->Rotation);
+		Entry.LastCaptureFrame = GFrameCounter;
+	}
+
+	TrimRenderTargets();
+
+	TotalSkippedCaptures += LastCaptureStats.GetSkipped();
+
+	INC_DWORD_STAT_BY(STAT_PortalCaptures, LastCaptureStats.Captured);
+	INC_DWORD_STAT_BY(STAT_PortalCapturesSkipped, LastCaptureStats.GetSkipped());
+
+	LastCaptureSeconds = FPlatformTime::Seconds() - StartTime;
+}
+
+void UPortalSubsystem::AddSweptBodies(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalTransit);
+
+	TArray<APortal*, TInlineAllocator<8>> LinkedPortals;
+	for (const FPortalCaptureEntry& Entry : Portals)
+	{
+		APortal* Portal = Entry.Portal.Get();
+		if (Portal && Portal->LinkedPortal.IsValid())
+			LinkedPortals.Add(Portal);
+	}
+	if (LinkedPortals.Num() == 0) return;
+
+	for (TActorIterator<AGrabableActor> It(GetWorld()); It; ++It)
+	{
+		for (APortal* Portal : LinkedPortals)
+			Portal->AddSweptBody(*It, DeltaTime);
+	}
+
+	for (TActorIterator<ATPSCharacter> It(GetWorld()); It; ++It)
+	{
+		for (APortal* Portal : LinkedPortals)
+			Portal->AddSweptBody(*It, DeltaTime);
+	}
+}
+
+void UPortalSubsystem::ResolveTransits()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalTransit);
+	const double StartTime = FPlatformTime::Seconds();
+
+	Transits.Reset();
+	for (const FPortalCaptureEntry& Entry : Portals)
+	{
+		if (APortal* Portal = Entry.Portal.Get())
+			Portal->CollectTransits(Transits);
+	}
+
+	if (Transits.Num() == 0 && MovementTransits.Num() == 0)
+	{
+		LastTransitSeconds = FPlatformTime::Seconds() - StartTime;
+		return;
+	}
+
+	// A body in two openings at once only goes through the one it reached first
+	Transits.Sort([](const FPortalTransit& A, const FPortalTransit& B) { return A.CrossTime < B.CrossTime; });
+	TSet<const AActor*, DefaultKeyFuncs<const AActor*>, TInlineSetAllocator<8>> Moved;
+	for (int32 i = 0; i < Transits.Num(); ++i)
+	{
+		bool bAlreadyMoved = true;
+		if (Transits[i].Actor.IsValid() && Transits[i].Portal.IsValid())
+			Moved.Add(Transits[i].Actor.Get(), &bAlreadyMoved);
+
+		if (bAlreadyMoved)
+			Transits.RemoveAt(i--, 1, false);
+	}
+
+	// Teleporting fires overlap events that change the portals' bodies, so every crossing was found first
+	for (FPortalTransit& Transit : Transits)
+	{
+		if (Transit.Actor.IsValid() == false || Transit.Portal.IsValid() == false) continue;
+
+		Transit.Portal->TeleportBody(Transit.Actor.Get(), Transit.CrossPoint);
+		if (Transit.Actor.IsValid())
+			Transit.ExitLocation = Transit.Actor->GetActorLocation();
+	}
+
+	// Already moved by their movement components
+	Transits.Append(MovementTransits);
+	MovementTransits.Reset();
+
+	// Cached traces from earlier in the frame saw the bodies before they moved
+	{
+		FScopeLock Lock(&TraceCacheLock);
+		TraceCache.Reset();
+		++TraceCacheGeneration;
+	}
+
+	INC_DWORD_STAT_BY(STAT_PortalTransits, Transits.Num());
+	LastTransitSeconds = FPlatformTime::Seconds() - StartTime;
+
+	OnPortalTransits.Broadcast(Transits);
+}
+
+TArrayView<const FPortalTransit> UPortalSubsystem::GetLastTransits() const
+{
+	return Transits;
+}
+
+void UPortalSubsystem::AddMovementTransit(APortal* Portal, AActor* Actor, const FVector& CrossPoint)
+{
+	FPortalTransit& Transit = MovementTransits.AddDefaulted_GetRef();
+	Transit.Portal = Portal;
+	Transit.Actor = Actor;
+	Transit.CrossPoint = CrossPoint;
+	Transit.CrossTime = 0.f;
+	Transit.ExitLocation = Actor->GetActorLocation();
+}
+
+void UPortalSubsystem::SetViewOverride(const FVector& Location, const FRotator& Rotation, float FOV, FIntPoint ViewSize)
+{
+	ViewOverride = FPortalCaptureScheduler::MakeView(Location, Rotation, FOV, ViewSize);
+}
+
+void UPortalSubsystem::ClearViewOverride()
+{
+	ViewOverride.Reset();
+}
+
+void UPortalSubsystem::GetViews(TArray<FPortalCaptureView, TInlineAllocator<2>>& OutViews) const
+{
+	if (ViewOverride.IsSet())
+	{
+		OutViews.Add(ViewOverride.GetValue());
+		return;
+	}
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr || PlayerController->IsLocalController() == false) continue;
+
+		ULocalPlayer* LocalPlayer = PlayerController->GetLocalPlayer();
+		if (LocalPlayer == nullptr || LocalPlayer->ViewportClient == nullptr) continue;
+
+		FSceneViewProjectionData ProjectionData;
+		if (LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, eSSP_FULL, ProjectionData) == false) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		FPortalCaptureView& View = OutViews.AddDefaulted_GetRef();
+		View.Location = ProjectionData.ViewOrigin;
+		View.Rotation = ViewRotation.Quaternion();
+		View.ProjectionMatrix = ProjectionData.ProjectionMatrix;
+		View.ViewSize = ProjectionData.GetConstrainedViewRect().Size();
+		GetViewFrustumBounds(View.Frustum, ProjectionData.ComputeViewProjectionMatrix(), false);
+	}
+}
+
+void UPortalSubsystem::UpdateViewTarget(APortal* Portal, FIntPoint Size)
+{
+	UTextureRenderTarget2D* ViewTarget = Portal->GetViewTarget();
+	if (ViewTarget && ViewTarget->SizeX == Size.X && ViewTarget->SizeY == Size.Y) return;
+
+	ReleaseRenderTarget(ViewTarget);
+	Portal->SetViewTarget(AcquireRenderTarget(Size));
+}
+
+UTextureRenderTarget2D* UPortalSubsystem::AcquireRenderTarget(FIntPoint Size)
+{
+	const int32 FreeIndex = FreeRenderTargets.IndexOfByPredicate([Size](const FPortalPooledRenderTarget& Pooled)
+	{
+		return Pooled.RenderTarget->SizeX == Size.X && Pooled.RenderTarget->SizeY == Size.Y;
+	});
+
+	if (FreeIndex != INDEX_NONE)
+	{
+		UTextureRenderTarget2D* RenderTarget = FreeRenderTargets[FreeIndex].RenderTarget;
+		FreeRenderTargets.RemoveAtSwap(FreeIndex);
+		return RenderTarget;
+	}
+
+	UTextureRenderTarget2D* RenderTarget = NewObject<UTextureRenderTarget2D>(this);
+	RenderTarget->RenderTargetFormat = RTF_RGBA16f;
+	RenderTarget->ClearColor = FLinearColor::Black;
+	RenderTarget->InitAutoFormat(Size.X, Size.Y);
+
+	++RenderTargetNum;
+	INC_DWORD_STAT(STAT_PortalRenderTargets);
+	return RenderTarget;
+}
+
+void UPortalSubsystem::ReleaseRenderTarget(UTextureRenderTarget2D* RenderTarget)
+{
+	if (RenderTarget == nullptr) return;
+	if (FreeRenderTargets.ContainsByPredicate([RenderTarget](const FPortalPooledRenderTarget& Pooled) { return Pooled.RenderTarget == RenderTarget; })) return;
+
+	FPortalPooledRenderTarget& Pooled = FreeRenderTargets.AddDefaulted_GetRef();
+	Pooled.RenderTarget = RenderTarget;
+	Pooled.ReleasedFrame = GFrameCounter;
+}
+
+void UPortalSubsystem::TrimRenderTargets()
+{
+	// Sizes nobody asked for in a while, e.g. after the viewport or the quality changed
+	for (int32 i = FreeRenderTargets.Num() - 1; i >= 0; --i)
+	{
+		if (GFrameCounter - FreeRenderTargets[i].ReleasedFrame < (uint64)FreeRenderTargetFrames) continue;
+
+		FreeRenderTargets.RemoveAtSwap(i);
+
+		--RenderTargetNum;
+		DEC_DWORD_STAT(STAT_PortalRenderTargets);
+	}
+}
+
+float UPortalSubsystem::GetPortalQuality() const
+{
+	UPortalGameInstance* GameInstance = GetWorld()->GetGameInstance<UPortalGameInstance>();
+	return GameInstance ? GameInstance->GetPortalQuality() : 0.4f;
+}
+
+bool UPortalSubsystem::IsTickable() const
+{
+	// Nothing is rendered on a dedicated server
+	if (IsTemplate() || GetWorld()->GetNetMode() == NM_DedicatedServer) return false;
+
+	return Portals.Num() > 0;
+}
+
+ETickableTickType UPortalSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UPortalSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UPortalSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPortalSubsystem, STATGROUP_Tickables);
+}
+
+void UPortalSubsystem::RegisterPortal(APortal* Portal)
+{
+	if (Portals.ContainsByPredicate([Portal](const FPortalCaptureEntry& Entry) { return Entry.Portal == Portal; })) return;
+
+	FPortalCaptureEntry& Entry = Portals.AddDefaulted_GetRef();
+	Entry.Portal = Portal;
+}
+
+void UPortalSubsystem::UnregisterPortal(APortal* Portal)
+{
+	Portals.RemoveAll([Portal](const FPortalCaptureEntry& Entry) { return Entry.Portal == Portal; });
+}
+
+APortal* UPortalSubsystem::GetPlayerPortal(const AActor* Owner, bool bPortalA) const
+{
+	const FPlayerPortalPair* Pair = PlayerPortals.FindByPredicate([Owner](const FPlayerPortalPair& Pair) { return Pair.Owner == Owner; });
+	return Pair ? Pair->Slots[bPortalA ? 0 : 1].GetShown() : nullptr;
+}
+
+FPlayerPortalPair& UPortalSubsystem::FindOrAddPlayerPortals(const AActor* Owner)
+{
+	// Players that left
+	PlayerPortals.RemoveAll([](const FPlayerPortalPair& Pair) { return Pair.Owner.IsValid() == false; });
+
+	FPlayerPortalPair* Pair = PlayerPortals.FindByPredicate([Owner](const FPlayerPortalPair& Pair) { return Pair.Owner == Owner; });
+	if (Pair) return *Pair;
+
+	FPlayerPortalPair& NewPair = PlayerPortals.AddDefaulted_GetRef();
+	NewPair.Owner = const_cast<AActor*>(Owner);
+	return NewPair;
+}
+
+APortal* UPortalSubsystem::PlacePlayerPortal(APlayerState* Owner, bool bPortalA, UClass* PortalClass, APortalWall* Wall, const FTransform& Transform, uint8 PredictionId)
+{
+	if (Owner == nullptr || PortalClass == nullptr || Wall == nullptr) return nullptr;
+
+	FPlayerPortalSlot& Slot = FindOrAddPlayerPortals(Owner).Slots[bPortalA ? 0 : 1];
+	if (APortal* OldPortal = Slot.Confirmed.Get())
+		OldPortal->Destroy();
+
+	APortal* Portal = GetWorld()->SpawnActorDeferred<APortal>(PortalClass, Transform, Owner);
+	if (Portal == nullptr) return nullptr;
+
+	Portal->SetPlacement(Wall, Owner, bPortalA, PredictionId, Transform.GetLocation());
+	Portal->FinishSpawning(Transform);
+	Slot.Confirmed = Portal;
+
+	RelinkPlayerPortals(FindOrAddPlayerPortals(Owner));
+	return Portal;
+}
+
+uint8 UPortalSubsystem::PredictPlayerPortal(APlayerState* Owner, bool bPortalA, UClass* PortalClass, APortalWall* Wall, const FTransform& Transform)
+{
+	if (Owner == nullptr || PortalClass == nullptr || Wall == nullptr) return 0;
+
+	FPlayerPortalSlot& Slot = FindOrAddPlayerPortals(Owner).Slots[bPortalA ? 0 : 1];
+	if (APortal* OldPortal = Slot.Predicted.Get())
+		OldPortal->Destroy();
+	Slot.Predicted.Reset();
+
+	// 0 means no prediction
+	if (++LastPredictionId == 0)
+		++LastPredictionId;
+
+	// Spawned on the client, never replicated
+	APortal* Portal = GetWorld()->SpawnActorDeferred<APortal>(PortalClass, Transform, Owner);
+	if (Portal == nullptr) return 0;
+
+	Portal->SetPlacement(Wall, Owner, bPortalA, LastPredictionId, Transform.GetLocation());
+	Portal->FinishSpawning(Transform);
+	Slot.Predicted = Portal;
+	Slot.PredictionId = LastPredictionId;
+
+	RelinkPlayerPortals(FindOrAddPlayerPortals(Owner));
+	return LastPredictionId;
+}
+
+void UPortalSubsystem::RejectPlayerPortal(const APlayerState* Owner, bool bPortalA, uint8 PredictionId)
+{
+	FPlayerPortalPair& Pair = FindOrAddPlayerPortals(Owner);
+	FPlayerPortalSlot& Slot = Pair.Slots[bPortalA ? 0 : 1];
+
+	// A later shot is still waiting for its answer
+	if (Slot.PredictionId != PredictionId) return;
+
+	if (APortal* Predicted = Slot.Predicted.Get())
+		Predicted->Destroy();
+	Slot.Predicted.Reset();
+
+	RelinkPlayerPortals(Pair);
+}
+
+void UPortalSubsystem::OnPortalReplicated(APortal* Portal)
+{
+	const FPortalPlacement& Placement = Portal->GetPlacement();
+	if (Placement.Player == nullptr) return;
+
+	FPlayerPortalPair& Pair = FindOrAddPlayerPortals(Placement.Player);
+	FPlayerPortalSlot& Slot = Pair.Slots[Placement.bPortalA ? 0 : 1];
+
+	// The server destroys the portal this one replaces, it may only arrive later
+	if (Slot.Confirmed.IsValid() && Slot.Confirmed != Portal)
+		Slot.Confirmed->SetPortalHidden(true);
+	Slot.Confirmed = Portal;
+
+	if (Placement.PredictionId != 0 && Placement.PredictionId == Slot.PredictionId)
+	{
+		if (APortal* Predicted = Slot.Predicted.Get())
+			Predicted->Destroy();
+		Slot.Predicted.Reset();
+	}
+
+	RelinkPlayerPortals(Pair);
+}
+
+void UPortalSubsystem::RelinkPlayerPortals(FPlayerPortalPair& Pair)
+{
+	APortal* Shown[2] = { Pair.Slots[0].GetShown(), Pair.Slots[1].GetShown() };
+
+	for (int32 i = 0; i < 2; ++i)
+	{
+		APortal* Confirmed = Pair.Slots[i].Confirmed.Get();
+		if (Confirmed && Confirmed != Shown[i])
+			Confirmed->SetPortalHidden(true);
+	}
+
+	for (int32 i = 0; i < 2; ++i)
+	{
+		if (Shown[i] == nullptr) continue;
+
+		Shown[i]->SetPortalHidden(false);
+		Shown[i]->SetLinkedPortal(Shown[1 - i]);
+	}
+}
+
+bool UPortalSubsystem::LineTraceThroughPortals(const FVector& Start, const FVector& End, ECollisionChannel Channel, const FCollisionQueryParams& Params, FPortalTraceResult& OutResult, int32 MaxDepth)
+{
+	return SweepThroughPortals(Start, End, FQuat::Identity, Channel, FCollisionShape(), Params, OutResult, MaxDepth);
+}
+
+bool UPortalSubsystem::SweepThroughPortals(const FVector& Start, const FVector& End, const FQuat& Rotation, ECollisionChannel Channel, const FCollisionShape& Shape, const FCollisionQueryParams& Params, FPortalTraceResult& OutResult, int32 MaxDepth)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PortalTrace);
+
+	if (MaxDepth == INDEX_NONE)
+		MaxDepth = MaxTraceDepth;
+
+	const FPortalTraceKey Key(Start, End, Rotation, Shape, Channel, Params, MaxDepth);
+	uint32 Generation;
+	{
+		FScopeLock Lock(&TraceCacheLock);
+
+		if (TraceCacheFrame != GFrameCounter)
+		{
+			TraceCache.Reset();
+			TraceCacheFrame = GFrameCounter;
+			++TraceCacheGeneration;
+		}
+		Generation = TraceCacheGeneration;
+
+		if (const FPortalTraceResult* Cached = TraceCache.Find(Key))
+		{
+			INC_DWORD_STAT(STAT_PortalTraceCacheHits);
+			OutResult = *Cached;
+			return OutResult.bBlockingHit;
+		}
+	}
+
+	OutResult = FPortalTraceResult();
+	TraceThroughPortals(Start, End, Rotation, Channel, Shape, Params, MaxDepth, OutResult);
+
+	// Not when the cache was cleared while tracing, the result may predate a transit
+	FScopeLock Lock(&TraceCacheLock);
+	if (TraceCacheGeneration == Generation)
+		TraceCache.Add(Key, OutResult);
+
+	return OutResult.bBlockingHit;
+}
+
+void UPortalSubsystem::TraceThroughPortals(const FVector& Start, const FVector& End, const FQuat& Rotation, ECollisionChannel Channel, const FCollisionShape& Shape, const FCollisionQueryParams& Params, int32 MaxDepth, FPortalTraceResult& OutResult) const
+{
+	const UWorld* World = GetWorld();
+
+	FVector LegStart = Start;
+	FVector LegEnd = End;
+	FQuat LegRotation = Rotation;
+
+	// Leg space back to the space the trace started in
+	FMatrix ToTraceSpace = FMatrix::Identity;
+
+	for (int32 Depth = 0; ; ++Depth)
+	{
+		FPortalTraceHit& Hit = OutResult.Hits.AddDefaulted_GetRef();
+		Hit.Start = LegStart;
+		Hit.End = LegEnd;
+
+		const float LegLength = FVector::Dist(LegStart, LegEnd);
+
+		if (Shape.IsLine())
+			Hit.bBlockingHit = World->LineTraceSingleByChannel(Hit.HitResult, LegStart, LegEnd, Channel, Params);
+		else
+			Hit.bBlockingHit = World->SweepSingleByChannel(Hit.HitResult, LegStart, LegEnd, LegRotation, Channel, Shape, Params);
+
+		float CrossTime = 1.f;
+		APortal* Portal = Depth < MaxDepth ? FindPortalCrossing(LegStart, LegEnd, CrossTime) : nullptr;
+
+		// Portals sit on their wall, an opening in front of or on the hit surface wins
+		const float PortalDistance = CrossTime * LegLength;
+		if (Portal && (Hit.bBlockingHit == false || PortalDistance <= Hit.HitResult.Distance + 1.f))
+		{
+			const FPortalLink& Link = Portal->GetPortalLink();
+			const FVector CrossPoint = FMath::Lerp(LegStart, LegEnd, CrossTime);
+
+			Hit.End = CrossPoint;
+			Hit.Portal = Portal;
+			Hit.HitResult = FHitResult();
+			Hit.bBlockingHit = false;
+			OutResult.Distance += PortalDistance;
+
+			ToTraceSpace = Link.GetInverseMatrix() * ToTraceSpace;
+
+			// Out of the linked portal's front, nudged off its wall
+			const FVector Direction = Link.TransformVector((LegEnd - LegStart).GetSafeNormal());
+			LegStart = Link.TransformPosition(CrossPoint) + Direction * 0.1f;
+			LegEnd = LegStart + Direction * (LegLength - PortalDistance);
+			LegRotation = Link.TransformRotation(LegRotation);
+			continue;
+		}
+
+		if (Hit.bBlockingHit)
+		{
+			OutResult.bBlockingHit = true;
+			OutResult.Distance += Hit.HitResult.Distance;
+			OutResult.TraceImpactPoint = ToTraceSpace.TransformPosition(Hit.HitResult.ImpactPoint);
+			OutResult.TraceImpactNormal = ToTraceSpace.TransformVector(Hit.HitResult.ImpactNormal);
+		}
+		else
+		{
+			OutResult.Distance += LegLength;
+		}
+		return;
+	}
+}
+
+APortal* UPortalSubsystem::FindPortalCrossing(const FVector& Start, const FVector& End, float& OutTime) const
+{
+	APortal* Crossed = nullptr;
+	OutTime = 1.f;
+
+	for (const FPortalCaptureEntry& Entry : Portals)
+	{
+		APortal* Portal = Entry.Portal.Get();
+		if (Portal == nullptr || Portal->LinkedPortal.IsValid() == false) continue;
+
+		float Time;
+		if (Portal->IntersectOpening(Start, End, Time) && Time <= OutTime)
+		{
+			Crossed = Portal;
+			OutTime = Time;
+		}
+	}
+	return Crossed;
+}
+
+void UPortalSubsystem::AddClone(APortal* Portal, AActor* Actor)
+{
+	if (GetWorld()->GetNetMode() == NM_DedicatedServer) return;
+	if (Clones.ContainsByPredicate([Portal, Actor](const FPortalClone& Clone) { return Clone.Portal == Portal && Clone.Actor == Actor; })) return;
+
+	USceneComponent* Root = Actor->GetRootComponent();
+	if (Root == nullptr) return;
+
+	const bool bWatched = Clones.ContainsByPredicate([Actor](const FPortalClone& Clone) { return Clone.Actor == Actor; });
+
+	FPortalClone& Clone = Clones.AddDefaulted_GetRef();
+	Clone.Portal = Portal;
+	Clone.Actor = Actor;
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Actor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		// Hidden from its owner, e.g. the player's body in first person, stays hidden on the other side too
+		if (Primitive->ShouldRender() == false || Primitive->bOwnerNoSee) continue;
+
+		if (UPrimitiveComponent* CloneComponent = AcquireCloneComponent(Primitive))
+		{
+			FPortalClonePart& Part = Clone.Parts.AddDefaulted_GetRef();
+			Part.Source = Primitive;
+			Part.Clone = CloneComponent;
+		}
+	}
+
+	if (bWatched == false)
+		Root->TransformUpdated.AddUObject(this, &UPortalSubsystem::OnCloneSourceMoved);
+}
+
+void UPortalSubsystem::RemoveClone(APortal* Portal, AActor* Actor)
+{
+	const int32 Index = Clones.IndexOfByPredicate([Portal, Actor](const FPortalClone& Clone) { return Clone.Portal == Portal && Clone.Actor == Actor; });
+	if (Index != INDEX_NONE)
+		ReleaseClone(Index);
+}
+
+void UPortalSubsystem::MarkClonesDirty(APortal* Portal)
+{
+	for (FPortalClone& Clone : Clones)
+	{
+		if (Clone.Portal == Portal)
+			Clone.bDirty = true;
+	}
+}
+
+void UPortalSubsystem::ReleaseClone(int32 Index)
+{
+	FPortalClone& Clone = Clones[Index];
+	for (const FPortalClonePart& Part : Clone.Parts)
+		ReleaseCloneComponent(Part.Clone.Get());
+
+	AActor* Actor = Clone.Actor.Get();
+	Clones.RemoveAtSwap(Index);
+
+	// Still straddling another portal, keep listening
+	if (Actor == nullptr || Actor->GetRootComponent() == nullptr) return;
+	if (Clones.ContainsByPredicate([Actor](const FPortalClone& Other) { return Other.Actor == Actor; })) return;
+
+	Actor->GetRootComponent()->TransformUpdated.RemoveAll(this);
+}
+
+void UPortalSubsystem::OnCloneSourceMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	AActor* Actor = UpdatedComponent->GetOwner();
+	for (FPortalClone& Clone : Clones)
+	{
+		if (Clone.Actor == Actor)
+			Clone.bDirty = true;
+	}
+}
+
+void UPortalSubsystem::UpdateClones()
+{
+	for (int32 i = Clones.Num() - 1; i >= 0; --i)
+	{
+		FPortalClone& Clone = Clones[i];
+		if (Clone.Actor.IsValid() == false || Clone.Portal.IsValid() == false || Clone.Portal->LinkedPortal.IsValid() == false)
+		{
+			ReleaseClone(i);
+			continue;
+		}
+
+		if (Clone.bDirty == false) continue;
+		Clone.bDirty = false;
+
+		const FPortalLink& Link = Clone.Portal->GetPortalLink();
+		for (const FPortalClonePart& Part : Clone.Parts)
+		{
+			if (Part.Source.IsValid() && Part.Clone.IsValid())
+				Part.Clone->SetWorldTransform(Link.TransformTransform(Part.Source->GetComponentTransform()));
+		}
+
+		INC_DWORD_STAT(STAT_PortalClonesMoved);
+	}
+}
+
+UPrimitiveComponent* UPortalSubsystem::AcquireCloneComponent(UPrimitiveComponent* Source)
+{
+	if (CloneHost == nullptr)
+	{
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags |= RF_Transient;
+		CloneHost = GetWorld()->SpawnActor<AActor>(SpawnParameters);
+		if (CloneHost == nullptr) return nullptr;
+	}
+
+	UMeshComponent* Clone = nullptr;
+	if (USkeletalMeshComponent* SkeletalSource = Cast<USkeletalMeshComponent>(Source))
+	{
+		if (SkeletalSource->SkeletalMesh == nullptr) return nullptr;
+
+		USkeletalMeshComponent* SkeletalClone = FreeSkeletalClones.Num() > 0 ? FreeSkeletalClones.Pop(false) : NewObject<USkeletalMeshComponent>(CloneHost);
+		SkeletalClone->SetSkeletalMesh(SkeletalSource->SkeletalMesh, false);
+		// Reuses the bones the source already evaluated instead of animating twice
+		SkeletalClone->SetMasterPoseComponent(SkeletalSource);
+		Clone = SkeletalClone;
+	}
+	else if (UStaticMeshComponent* StaticSource = Cast<UStaticMeshComponent>(Source))
+	{
+		if (StaticSource->GetStaticMesh() == nullptr) return nullptr;
+
+		UStaticMeshComponent* StaticClone = FreeStaticClones.Num() > 0 ? FreeStaticClones.Pop(false) : NewObject<UStaticMeshComponent>(CloneHost);
+		StaticClone->SetStaticMesh(StaticSource->GetStaticMesh());
+		Clone = StaticClone;
+	}
+	else
+	{
+		return nullptr;
+	}
+
+	if (Clone->IsRegistered() == false)
+	{
+		Clone->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Clone->SetGenerateOverlapEvents(false);
+		Clone->SetMobility(EComponentMobility::Movable);
+		Clone->RegisterComponent();
+	}
+
+	for (int32 i = 0; i < Source->GetNumMaterials(); ++i)
+		Clone->SetMaterial(i, Source->GetMaterial(i));
+
+	Clone->SetVisibility(true);
+	return Clone;
+}
+
+void UPortalSubsystem::ReleaseCloneComponent(UPrimitiveComponent* Clone)
+{
+	if (Clone == nullptr) return;
+
+	// Kept registered, the next clone only swaps the mesh
+	Clone->SetVisibility(false);
+
+	if (USkeletalMeshComponent* SkeletalClone = Cast<USkeletalMeshComponent>(Clone))
+	{
+		SkeletalClone->SetMasterPoseComponent(nullptr);
+		SkeletalClone->EmptyOverrideMaterials();
+		FreeSkeletalClones.Add(SkeletalClone);
+	}
+	else if (UStaticMeshComponent* StaticClone = Cast<UStaticMeshComponent>(Clone))
+	{
+		StaticClone->EmptyOverrideMaterials();
+		FreeStaticClones.Add(StaticClone);
+	}
+}
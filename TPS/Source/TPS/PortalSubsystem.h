@@ -0,0 +1,320 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "PortalCaptureScheduler.h"
+#include "PortalTrace.h"
+#include "Engine/EngineBaseTypes.h"
+#include "PortalSubsystem.generated.h"
+
+// A body that went into a portal's opening this frame
+struct FPortalTransit
+{
+	TWeakObjectPtr<class APortal> Portal;
+	TWeakObjectPtr<AActor> Actor;
+	FVector CrossPoint;
+
+	// Fraction of the body's path since the last check, the earliest crossing wins
+	float CrossTime;
+
+	// Where the body ended up, filled in once it was moved
+	FVector ExitLocation;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FPortalTransitsDelegate, TArrayView<const FPortalTransit>)
+
+// Runs UPortalSubsystem::AddSweptBodies once per frame in TG_PrePhysics
+struct FPortalSweepTickFunction : public FTickFunction
+{
+	class UPortalSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+// Runs UPortalSubsystem::ResolveTransits once per frame in TG_PostPhysics
+struct FPortalTransitTickFunction : public FTickFunction
+{
+	class UPortalSubsystem* Subsystem = nullptr;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+// One color of a player's pair
+struct FPlayerPortalSlot
+{
+	// Placed by the server
+	TWeakObjectPtr<class APortal> Confirmed;
+
+	// Local guess shown instead of Confirmed until the server answers
+	TWeakObjectPtr<class APortal> Predicted;
+	uint8 PredictionId = 0;
+
+	class APortal* GetShown() const { return Predicted.IsValid() ? Predicted.Get() : Confirmed.Get(); }
+};
+
+struct FPlayerPortalPair
+{
+	TWeakObjectPtr<AActor> Owner;
+
+	// Portal A, then portal B
+	FPlayerPortalSlot Slots[2];
+};
+
+// A capture target waiting in the pool for a portal of its size
+USTRUCT()
+struct FPortalPooledRenderTarget
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class UTextureRenderTarget2D* RenderTarget = nullptr;
+
+	uint64 ReleasedFrame = 0;
+};
+
+/**
+ * World level bookkeeping for portals.
+ * Bodies go through portals in one phase after physics. Before physics,
+ * bodies whose step reaches an opening are handed to the portal so a fast
+ * one does not hit the wall on its way through. After it, every portal
+ * reports what crossed its opening, a body that crossed more than one only
+ * takes the earliest, then all of them are moved at once. The camera update,
+ * the laser and the captures all run later in the frame and see where the
+ * bodies ended up.
+ *
+ * Every player owns one pair, placed through PlacePlayerPortal. Each pair
+ * links only its own two portals, any number of pairs can be in the world.
+ * Only the server places portals. A client shows its own shot right away
+ * with a local portal from PredictPlayerPortal, which the replicated one
+ * replaces once it arrives or which goes away if the server refuses the spot.
+ *
+ * Captures run once per frame at the end of the world tick, after the player
+ * cameras updated. FPortalCaptureScheduler picks the portals worth refreshing
+ * and only those capture, the rest keep their last image. A portal is
+ * captured from the local player view nearest to it, at a resolution picked
+ * from how much of the screen it covers and snapped to ResolutionScales of
+ * the viewport. Render targets come from a pool shared by every portal.
+ *
+ * Traces that should see through portals go through LineTraceThroughPortals
+ * and SweepThroughPortals. Identical queries share one result until the
+ * frame ends or bodies go through portals.
+ *
+ * A body straddling a portal is shown coming out of the linked one by a
+ * clone: pooled mesh components copying its meshes, moved only on frames the
+ * body moved. Skeletal meshes follow the body's pose as master pose slaves.
+ */
+UCLASS(config = Game)
+class TPS_API UPortalSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPortalSubsystem();
+
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterPortal(class APortal* Portal);
+	void UnregisterPortal(class APortal* Portal);
+
+	// Hands every character and grabable actor near a linked portal to APortal::AddSweptBody before physics moves them
+	void AddSweptBodies(float DeltaTime);
+
+	// Collects the crossings of every portal, keeps the earliest one of each body and moves them
+	void ResolveTransits();
+
+	// Bodies moved through a portal this frame
+	TArrayView<const FPortalTransit> GetLastTransits() const;
+
+	// A character went through Portal in its own move, published with the next ResolveTransits
+	void AddMovementTransit(class APortal* Portal, AActor* Actor, const FVector& CrossPoint);
+
+	// Broadcast after ResolveTransits moved at least one body
+	FPortalTransitsDelegate OnPortalTransits;
+
+	// Owner is the player's state, known on every machine. The predicted portal while there is one
+	class APortal* GetPlayerPortal(const AActor* Owner, bool bPortalA) const;
+
+	// Server only. Replaces Owner's portal of that color by a new one on Wall, linked to the other one of the pair.
+	// PredictionId is the client's guess this placement answers
+	class APortal* PlacePlayerPortal(class APlayerState* Owner, bool bPortalA, UClass* PortalClass, class APortalWall* Wall, const FTransform& Transform, uint8 PredictionId = 0);
+
+	// Client only. Shows a local portal until the server's arrives, returns the id to send with the request
+	uint8 PredictPlayerPortal(class APlayerState* Owner, bool bPortalA, UClass* PortalClass, class APortalWall* Wall, const FTransform& Transform);
+	void RejectPlayerPortal(const class APlayerState* Owner, bool bPortalA, uint8 PredictionId);
+
+	// A portal the server placed reached this client
+	void OnPortalReplicated(class APortal* Portal);
+
+	const FPortalCaptureStats& GetLastCaptureStats() const { return LastCaptureStats; }
+
+	// Captures from this view instead of the local players', for worlds without any such as the stress commandlet
+	void SetViewOverride(const FVector& Location, const FRotator& Rotation, float FOV, FIntPoint ViewSize);
+	void ClearViewOverride();
+
+	// Captures skipped since the world started
+	uint64 GetTotalSkippedCaptures() const { return TotalSkippedCaptures; }
+
+	// Game thread time of the last ResolveTransits and the last capture pass, for profiling
+	double GetLastTransitSeconds() const { return LastTransitSeconds; }
+	double GetLastCaptureSeconds() const { return LastCaptureSeconds; }
+
+	class UTextureRenderTarget2D* AcquireRenderTarget(FIntPoint Size);
+	void ReleaseRenderTarget(class UTextureRenderTarget2D* RenderTarget);
+
+	int32 GetRenderTargetNum() const { return RenderTargetNum; }
+
+	// Follows the trace through every linked portal opening it enters from the front, at most MaxDepth portals deep.
+	// INDEX_NONE uses MaxTraceDepth. Returns whether something blocked it
+	bool LineTraceThroughPortals(const FVector& Start, const FVector& End, ECollisionChannel Channel, const FCollisionQueryParams& Params, FPortalTraceResult& OutResult, int32 MaxDepth = INDEX_NONE);
+
+	// As LineTraceThroughPortals, portals are entered where the center of the shape crosses the opening
+	bool SweepThroughPortals(const FVector& Start, const FVector& End, const FQuat& Rotation, ECollisionChannel Channel, const FCollisionShape& Shape, const FCollisionQueryParams& Params, FPortalTraceResult& OutResult, int32 MaxDepth = INDEX_NONE);
+
+	// Linked portal whose opening Start to End enters first, nullptr when none
+	class APortal* FindPortalCrossing(const FVector& Start, const FVector& End, float& OutTime) const;
+
+	// Shows Actor coming out of Portal's linked portal until RemoveClone
+	void AddClone(class APortal* Portal, AActor* Actor);
+	void RemoveClone(class APortal* Portal, AActor* Actor);
+
+	// The link of Portal changed, its clones move on the next tick
+	void MarkClonesDirty(class APortal* Portal);
+
+	int32 GetCloneNum() const { return Clones.Num(); }
+
+private:
+
+	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaTime);
+
+	// Picks the portals worth refreshing from this frame's player views and captures them
+	void CapturePortals();
+
+	void TraceThroughPortals(const FVector& Start, const FVector& End, const FQuat& Rotation, ECollisionChannel Channel, const FCollisionShape& Shape, const FCollisionQueryParams& Params, int32 MaxDepth, FPortalTraceResult& OutResult) const;
+
+	void GetViews(TArray<FPortalCaptureView, TInlineAllocator<2>>& OutViews) const;
+
+	void UpdateViewTarget(class APortal* Portal, FIntPoint Size);
+
+	void TrimRenderTargets();
+
+	float GetPortalQuality() const;
+
+	FPlayerPortalPair& FindOrAddPlayerPortals(const AActor* Owner);
+
+	// Links the shown portal of each color to the other one and hides the ones a prediction replaces
+	void RelinkPlayerPortals(FPlayerPortalPair& Pair);
+
+	void UpdateClones();
+	void ReleaseClone(int32 Index);
+
+	UPrimitiveComponent* AcquireCloneComponent(UPrimitiveComponent* Source);
+	void ReleaseCloneComponent(UPrimitiveComponent* Clone);
+
+	void OnCloneSourceMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+private:
+
+	struct FPortalCaptureEntry
+	{
+		TWeakObjectPtr<class APortal> Portal;
+		uint64 LastCaptureFrame = 0;
+	};
+
+	TArray<FPortalCaptureEntry> Portals;
+
+	TArray<FPlayerPortalPair> PlayerPortals;
+
+	FPortalSweepTickFunction SweepTickFunction;
+	FPortalTransitTickFunction TransitTickFunction;
+	FDelegateHandle PostActorTickHandle;
+	TArray<FPortalTransit> Transits;
+	TArray<FPortalTransit> MovementTransits;
+
+	uint8 LastPredictionId;
+
+	UPROPERTY(config)
+	int32 MaxCapturesPerFrame;
+
+	UPROPERTY(config)
+	int32 RoundRobinCapturesPerFrame;
+
+	UPROPERTY(config)
+	float MaxCaptureDistance;
+
+	// A portal drawn on screen within this many seconds counts as visible last frame
+	UPROPERTY(config)
+	float VisibleTolerance;
+
+	// Fractions of the viewport a capture may use, ascending. Multiplied by the portal quality setting
+	UPROPERTY(config)
+	TArray<float> ResolutionScales;
+
+	// Frames a free target stays in the pool before it is let go
+	UPROPERTY(config)
+	int32 FreeRenderTargetFrames;
+
+	UPROPERTY()
+	TArray<FPortalPooledRenderTarget> FreeRenderTargets;
+
+	// Pooled targets alive, free or in use
+	int32 RenderTargetNum;
+
+	// Portals one trace may pass through
+	UPROPERTY(config)
+	int32 MaxTraceDepth;
+
+	// Results of this frame's traces since the last transits, callers may be on animation worker threads
+	TMap<FPortalTraceKey, FPortalTraceResult> TraceCache;
+	uint64 TraceCacheFrame;
+	uint32 TraceCacheGeneration;
+	FCriticalSection TraceCacheLock;
+
+	FPortalCaptureStats LastCaptureStats;
+	TOptional<FPortalCaptureView> ViewOverride;
+	uint64 TotalSkippedCaptures;
+
+	double LastTransitSeconds;
+	double LastCaptureSeconds;
+
+	struct FPortalClonePart
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Source;
+		TWeakObjectPtr<UPrimitiveComponent> Clone;
+	};
+
+	struct FPortalClone
+	{
+		TWeakObjectPtr<class APortal> Portal;
+		TWeakObjectPtr<AActor> Actor;
+		TArray<FPortalClonePart, TInlineAllocator<2>> Parts;
+
+		// Actor or the portal link moved since the parts were placed
+		bool bDirty = true;
+	};
+
+	TArray<FPortalClone> Clones;
+
+	// Owns every clone component, used or pooled
+	UPROPERTY()
+	AActor* CloneHost;
+
+	UPROPERTY()
+	TArray<UStaticMeshComponent*> FreeStaticClones;
+
+	UPROPERTY()
+	TArray<USkeletalMeshComponent*> FreeSkeletalClones;
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PortalTrace.h"
+
+FPortalTraceKey::FPortalTraceKey(const FVector& InStart, const FVector& InEnd, const FQuat& InRotation, const FCollisionShape& InShape, ECollisionChannel InChannel, const FCollisionQueryParams& Params, int32 InMaxDepth)
+	: Start(InStart)
+	, End(InEnd)
+	, Rotation(InRotation)
+	, Shape(InShape)
+	, Channel(InChannel)
+	, MaxDepth(InMaxDepth)
+	, bTraceComplex(Params.bTraceComplex)
+	, bFindInitialOverlaps(Params.bFindInitialOverlaps)
+	, bReturnFaceIndex(Params.bReturnFaceIndex)
+	, bReturnPhysicalMaterial(Params.bReturnPhysicalMaterial)
+	, bIgnoreBlocks(Params.bIgnoreBlocks)
+	, bIgnoreTouches(Params.bIgnoreTouches)
+	, bSkipNarrowPhase(Params.bSkipNarrowPhase)
+	, bTraceIntoSubComponents(Params.bTraceIntoSubComponents)
+	, MobilityType(Params.MobilityType)
+	, IgnoreMask(Params.IgnoreMask)
+	, IgnoredActors(Params.GetIgnoredActors())
+	, IgnoredComponents(Params.GetIgnoredComponents())
+{
+	IgnoredActors.Sort();
+	IgnoredComponents.Sort();
+}
+
+bool FPortalTraceKey::operator==(const FPortalTraceKey& Other) const
+{
+	return Start == Other.Start
+		&& End == Other.End
+		&& Rotation == Other.Rotation
+		&& Shape.ShapeType == Other.Shape.ShapeType
+		&& Shape.GetExtent() == Other.Shape.GetExtent()
+		&& Channel == Other.Channel
+		&& MaxDepth == Other.MaxDepth
+		&& bTraceComplex == Other.bTraceComplex
+		&& bFindInitialOverlaps == Other.bFindInitialOverlaps
+		&& bReturnFaceIndex == Other.bReturnFaceIndex
+		&& bReturnPhysicalMaterial == Other.bReturnPhysicalMaterial
+		&& bIgnoreBlocks == Other.bIgnoreBlocks
+		&& bIgnoreTouches == Other.bIgnoreTouches
+		&& bSkipNarrowPhase == Other.bSkipNarrowPhase
+		&& bTraceIntoSubComponents == Other.bTraceIntoSubComponents
+		&& MobilityType == Other.MobilityType
+		&& IgnoreMask == Other.IgnoreMask
+		&& IgnoredActors == Other.IgnoredActors
+		&& IgnoredComponents == Other.IgnoredComponents;
+}
+
+uint32 GetTypeHash(const FPortalTraceKey& Key)
+{
+	uint32 Hash = HashCombine(GetTypeHash(Key.Start), GetTypeHash(Key.End));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)Key.Channel));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)Key.Shape.ShapeType));
+	Hash = HashCombine(Hash, GetTypeHash(Key.MaxDepth));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)Key.MobilityType));
+	for (uint32 IgnoredActor : Key.IgnoredActors)
+		Hash = HashCombine(Hash, IgnoredActor);
+	for (uint32 IgnoredComponent : Key.IgnoredComponents)
+		Hash = HashCombine(Hash, IgnoredComponent);
+	return Hash;
+}
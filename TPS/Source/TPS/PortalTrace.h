@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "CollisionShape.h"
+#include "Engine/EngineTypes.h"
+
+// One straight leg of a trace through portals
+struct FPortalTraceHit
+{
+	FVector Start;
+	FVector End;
+
+	// Portal the leg went into, the next leg starts out of its linked portal
+	TWeakObjectPtr<class APortal> Portal;
+
+	// Blocking hit that ended the leg, only on the last one
+	FHitResult HitResult;
+	bool bBlockingHit = false;
+};
+
+/**
+ * Result of UPortalSubsystem::LineTraceThroughPortals and SweepThroughPortals.
+ * Hits are the legs in order, the world space of each leg is the side of the
+ * portal it ran on. TraceImpactPoint and TraceImpactNormal map the blocking
+ * hit back to the side the trace started on, e.g. for foot placement.
+ */
+struct FPortalTraceResult
+{
+	TArray<FPortalTraceHit, TInlineAllocator<4>> Hits;
+
+	bool bBlockingHit = false;
+
+	// Length travelled over all legs up to the blocking hit or the end
+	float Distance = 0.f;
+
+	FVector TraceImpactPoint = FVector::ZeroVector;
+	FVector TraceImpactNormal = FVector::ZeroVector;
+
+	int32 GetPortalNum() const { return FMath::Max(0, Hits.Num() - 1); }
+
+	// The blocking hit in the space of the last leg, nullptr when nothing was hit
+	const FHitResult* GetBlockingHit() const { return bBlockingHit ? &Hits.Last().HitResult : nullptr; }
+};
+
+// Identifies a query for the trace cache, two queries with equal keys hit the same things
+struct FPortalTraceKey
+{
+	FVector Start;
+	FVector End;
+	FQuat Rotation;
+	FCollisionShape Shape;
+	ECollisionChannel Channel;
+	int32 MaxDepth;
+
+	// Everything of FCollisionQueryParams that changes the result, the stat and tags only name the query
+	bool bTraceComplex;
+	bool bFindInitialOverlaps;
+	bool bReturnFaceIndex;
+	bool bReturnPhysicalMaterial;
+	bool bIgnoreBlocks;
+	bool bIgnoreTouches;
+	bool bSkipNarrowPhase;
+	bool bTraceIntoSubComponents;
+	EQueryMobilityType MobilityType;
+	FMaskFilter IgnoreMask;
+	FCollisionQueryParams::IgnoreActorsArrayType IgnoredActors;
+	FCollisionQueryParams::IgnoreComponentsArrayType IgnoredComponents;
+
+	FPortalTraceKey(const FVector& InStart, const FVector& InEnd, const FQuat& InRotation, const FCollisionShape& InShape, ECollisionChannel InChannel, const FCollisionQueryParams& Params, int32 InMaxDepth);
+
+	bool operator==(const FPortalTraceKey& Other) const;
+	friend uint32 GetTypeHash(const FPortalTraceKey& Key);
+};
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "Engine/World.h"
+#include "StandaloneGameWorld.h"
+#include "Portal.h"
+#include "PortalSubsystem.h"
+#include "GrabableActor.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPortalTransitOnceTest, "TPS.Portal.TransitOnce", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+namespace
+{
+	const TCHAR* TransitPortalClassPath = TEXT("Class'/Game/Portal/BP_Portal.BP_Portal_C'");
+	const TCHAR* TransitCubeClassPath = TEXT("Class'/Game/Platforms/BP_MirrorCube.BP_MirrorCube_C'");
+}
+
+bool FPortalTransitOnceTest::RunTest(const FString& Parameters)
+{
+	UClass* PortalClass = FStandaloneGameWorld::LoadClass(TransitPortalClassPath);
+	UClass* CubeClass = FStandaloneGameWorld::LoadClass(TransitCubeClassPath);
+	if (TestNotNull(TEXT("Portal class"), PortalClass) == false || TestNotNull(TEXT("Cube class"), CubeClass) == false)
+		return false;
+
+	FStandaloneGameWorld GameWorld(TEXT("PortalTransitTest"));
+	UWorld* World = GameWorld.Get();
+
+	// Portal A faces the cubes, B sends them on away from both
+	const FTransform TransformA(FRotator::ZeroRotator, FVector(0.f, 0.f, 200.f));
+	const FTransform TransformB(FRotator::ZeroRotator, FVector(0.f, 5000.f, 200.f));
+
+	APortal* PortalA = World->SpawnActorDeferred<APortal>(PortalClass, TransformA);
+	APortal* PortalB = World->SpawnActorDeferred<APortal>(PortalClass, TransformB);
+	if (TestNotNull(TEXT("Portal A"), PortalA) == false || TestNotNull(TEXT("Portal B"), PortalB) == false)
+		return false;
+
+	PortalA->PortalA = true;
+	PortalB->PortalA = false;
+	PortalA->FinishSpawning(TransformA);
+	PortalB->FinishSpawning(TransformB);
+	PortalA->LinkPortal(PortalB);
+
+	UPortalSubsystem* PortalSubsystem = World->GetSubsystem<UPortalSubsystem>();
+	if (TestNotNull(TEXT("Portal subsystem"), PortalSubsystem) == false)
+		return false;
+
+	TMap<const AActor*, int32> TransitCounts;
+	const FDelegateHandle TransitsHandle = PortalSubsystem->OnPortalTransits.AddLambda([&TransitCounts](TArrayView<const FPortalTransit> Transits)
+	{
+		for (const FPortalTransit& Transit : Transits)
+			++TransitCounts.FindOrAdd(Transit.Actor.Get());
+	});
+
+	// Up to a few metres per frame, past what the portal volume is deep
+	const float Speeds[] = { 500.f, 2000.f, 8000.f, 20000.f };
+	const float FrameTimes[] = { 1.f / 120.f, 1.f / 60.f, 1.f / 30.f, 1.f / 15.f };
+	const float StartDistance = 600.f;
+	const float TravelDistance = StartDistance + 2000.f;
+
+	for (float FrameTime : FrameTimes)
+	{
+		for (float Speed : Speeds)
+		{
+			FActorSpawnParameters SpawnParameters;
+			SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			AGrabableActor* Cube = World->SpawnActor<AGrabableActor>(CubeClass, FTransform(TransformA.GetLocation() + FVector(StartDistance, 0.f, 0.f)), SpawnParameters);
+			if (TestNotNull(TEXT("Cube"), Cube) == false) continue;
+
+			if (UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Cube->GetRootComponent()))
+				Root->SetEnableGravity(false);
+			Cube->SetVelocity(FVector(-Speed, 0.f, 0.f));
+
+			const int32 NumFrames = FMath::CeilToInt(TravelDistance / (Speed * FrameTime)) + 2;
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+				World->Tick(LEVELTICK_All, FrameTime);
+
+			TestEqual(FString::Printf(TEXT("Transits at %.0f cm/s, %.1f ms frames"), Speed, FrameTime * 1000.f), TransitCounts.FindRef(Cube), 1);
+
+			Cube->Destroy();
+		}
+	}
+
+	PortalSubsystem->OnPortalTransits.Remove(TransitsHandle);
+
+	return true;
+}
+
+#endif
@@ -4,6 +4,9 @@
 #include "PortalWall.h"
 #include "Portal.h"
 
+static const float PortalWidth = 180.f;
+static const float PortalHeight = 249.f;
+
 // Sets default values
 APortalWall::APortalWall()
 {
@@ -31,15 +34,12 @@ void APortalWall::OnConstruction(const FTransform& Transform)
 	SetActorRelativeScale3D(FVector(1.f, Width / 100.f, Height / 100.f));
 }
 
-std::pair<bool, FTransform> APortalWall::ClampPortalPosition(FVector Location, TWeakObjectPtr<APortal> LinkedPortal)
+std::pair<bool, FTransform> APortalWall::ClampPortalPosition(FVector Location, const APortal* ReplacedPortal)
 {
 	FTransform ClampTransform;
 	FVector ClampLocation;
 	FVector LocalLocation = GetTransform().InverseTransformPositionNoScale(Location);
 
-	const float PortalWidth = 180.f;
-	const float PortalHeight = 249.f;
-
 	ClampLocation.X = 1.f;
 	ClampLocation.Y = FMath::Clamp(FMath::Abs(LocalLocation.Y), 0.f, Width / 2 - PortalWidth / 2);
 	ClampLocation.Z = FMath::Clamp(FMath::Abs(LocalLocation.Z), 0.f, Height / 2 - PortalHeight / 2);
@@ -54,25 +54,65 @@ std::pair<bool, FTransform> APortalWall::ClampPortalPosition(FVector Location, T
 		ClampLocation.Z *= -1.f;
 	}
 
-	if (LinkedPortal.IsValid())
-	{
-		FVector LinkedPortalLocalLocation = GetTransform().InverseTransformPositionNoScale(LinkedPortal->GetActorLocation());
-		bool CanSpawn = CheckOverlapLinkedPortal(ClampLocation, LinkedPortalLocalLocation);
+	bool CanSpawn = CheckOverlapPortals(ClampLocation, ReplacedPortal);
 
-		ClampLocation = GetTransform().TransformPositionNoScale(ClampLocation);
+	ClampLocation = GetTransform().TransformPositionNoScale(ClampLocation);
 
-		ClampTransform = FTransform(GetActorRotation(), ClampLocation);
+	ClampTransform = FTransform(GetActorRotation(), ClampLocation);
 
-		return std::make_pair(CanSpawn, ClampTransform);
-	}
-	else
-	{
-		ClampLocation = GetTransform().TransformPositionNoScale(ClampLocation);
+	return std::make_pair(CanSpawn, ClampTransform);
+}
 
-		ClampTransform = FTransform(GetActorRotation(), ClampLocation);
+FIntPoint APortalWall::GetPortalCell(const FVector& LocalLocation) const
+{
+	return FIntPoint(FMath::FloorToInt(LocalLocation.Y / PortalWidth), FMath::FloorToInt(LocalLocation.Z / PortalHeight));
+}
 
-		return std::make_pair(true, ClampTransform);
+bool APortalWall::CheckOverlapPortals(const FVector& LocalLocation, const APortal* IgnoredPortal)
+{
+	const FIntPoint Cell = GetPortalCell(LocalLocation);
+
+	for (int32 Y = -1; Y <= 1; ++Y)
+	{
+		for (int32 Z = -1; Z <= 1; ++Z)
+		{
+			const TArray<FWallPortal, TInlineAllocator<2>>* Portals = PortalCells.Find(Cell + FIntPoint(Y, Z));
+			if (Portals == nullptr) continue;
+
+			for (const FWallPortal& WallPortal : *Portals)
+			{
+				if (WallPortal.Portal.IsValid() == false || WallPortal.Portal.Get() == IgnoredPortal) continue;
+
+				if (CheckOverlapLinkedPortal(LocalLocation, WallPortal.LocalLocation) == false)
+					return false;
+			}
+		}
 	}
+	return true;
+}
+
+void APortalWall::AddPortal(APortal* Portal)
+{
+	RemovePortal(Portal);
+
+	FWallPortal WallPortal;
+	WallPortal.Portal = Portal;
+	WallPortal.LocalLocation = GetTransform().InverseTransformPositionNoScale(Portal->GetActorLocation());
+
+	const FIntPoint Cell = GetPortalCell(WallPortal.LocalLocation);
+	PortalCells.FindOrAdd(Cell).Add(WallPortal);
+	PortalCellOf.Add(Portal, Cell);
+}
+
+void APortalWall::RemovePortal(APortal* Portal)
+{
+	FIntPoint Cell;
+	if (PortalCellOf.RemoveAndCopyValue(Portal, Cell) == false) return;
+
+	TArray<FWallPortal, TInlineAllocator<2>>& Portals = PortalCells.FindChecked(Cell);
+	Portals.RemoveAllSwap([Portal](const FWallPortal& WallPortal) { return WallPortal.Portal == Portal; });
+	if (Portals.Num() == 0)
+		PortalCells.Remove(Cell);
 }
 
 bool APortalWall::CheckOverlapLinkedPortal(FVector PositionA, FVector PositionB)
@@ -88,9 +128,6 @@ bool APortalWall::CheckOverlapLinkedPortal(FVector PositionA, FVector PositionB)
 	if (FMath::Abs(A_X - B_X) > 0.01f)
 		return true;
 
-	const float PortalWidth = 180.f;
-	const float PortalHeight = 249.f;
-
 	if (A_Y + PortalWidth / 2 < B_Y - PortalWidth / 2)
 		return true;
 	if (B_Y + PortalWidth / 2 < A_Y - PortalWidth / 2)
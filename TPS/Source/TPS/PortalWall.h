@@ -23,10 +23,23 @@ protected:
 
 public:	
 
-	std::pair<bool, FTransform> ClampPortalPosition(FVector Location, TWeakObjectPtr<class APortal> LinkedPortal);
+	// Clamps Location onto the wall, false when the portal would overlap one already on it.
+	// ReplacedPortal is about to be destroyed and is not in the way
+	std::pair<bool, FTransform> ClampPortalPosition(FVector Location, const class APortal* ReplacedPortal);
 
 	bool CheckOverlapLinkedPortal(FVector PositionA, FVector PositionB);
 
+	// Portals shot on this wall, added again when one moves
+	void AddPortal(class APortal* Portal);
+	void RemovePortal(class APortal* Portal);
+
+private:
+
+	FIntPoint GetPortalCell(const FVector& LocalLocation) const;
+
+	// Only the cells around LocalLocation are looked at
+	bool CheckOverlapPortals(const FVector& LocalLocation, const class APortal* IgnoredPortal);
+
 private:
 
 	UPROPERTY(VisibleDefaultsOnly)
@@ -38,5 +51,13 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (AllowPrivateAccess = "true"), Category = "BasicSetting")
 	float Height;
 
-	
+	struct FWallPortal
+	{
+		TWeakObjectPtr<class APortal> Portal;
+		FVector LocalLocation;
+	};
+
+	// Cells are the size of a portal, so a portal overlapping another is at most one cell away
+	TMap<FIntPoint, TArray<FWallPortal, TInlineAllocator<2>>> PortalCells;
+	TMap<const class APortal*, FIntPoint> PortalCellOf;
 };
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StandaloneGameWorld.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+
+FStandaloneGameWorld::FStandaloneGameWorld(const TCHAR* Name)
+{
+	World = UWorld::CreateWorld(EWorldType::Game, false, Name);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	// There is no game mode to start the match, begin play by hand
+	World->GetWorldSettings()->NotifyBeginPlay();
+}
+
+FStandaloneGameWorld::~FStandaloneGameWorld()
+{
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+}
+
+UClass* FStandaloneGameWorld::LoadClass(const TCHAR* ClassPath)
+{
+	return Cast<UClass>(StaticLoadObject(UClass::StaticClass(), NULL, ClassPath));
+}
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * An empty game world outside of any map, created and begun play by hand,
+ * for automation tests and commandlets. Destroyed with this object.
+ */
+class TPS_API FStandaloneGameWorld
+{
+public:
+
+	explicit FStandaloneGameWorld(const TCHAR* Name);
+	~FStandaloneGameWorld();
+
+	UE_NONCOPYABLE(FStandaloneGameWorld);
+
+	UWorld* Get() const { return World; }
+
+	// Blueprint class from a Class'...' path, nullptr when it does not load
+	static UClass* LoadClass(const TCHAR* ClassPath);
+
+private:
+
+	UWorld* World;
+};
@@ -9,5 +9,12 @@ public class TPS : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay", "Sockets", "UMG", "OnlineSubsystem", "OnlineSubsystemSteam", "SlateCore" });
+
+		// Contact modification for bodies passing through portals
+		PrivateDependencyModuleNames.Add("PhysicsCore");
+		if (Target.bCompilePhysX)
+		{
+			PrivateDependencyModuleNames.Add("PhysX");
+		}
 	}
 }
@@ -2,6 +2,23 @@
 
 #include "TPS.h"
 #include "Modules/ModuleManager.h"
+#include "PortalCollisionFilter.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, TPS, "TPS" );
+class FTPSGameModule : public FDefaultGameModuleImpl
+{
+public:
+
+	virtual void StartupModule() override
+	{
+		// Before any world creates its physics scene
+		FPortalCollisionFilter::Register();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FPortalCollisionFilter::Unregister();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FTPSGameModule, TPS, "TPS" );
  
\ No newline at end of file
@@ -19,10 +19,18 @@
 #include "Components/ArrowComponent.h"
 #include "Components/SceneCaptureComponent2D.h"
 #include "Sound/SoundCue.h"
+#include "PortalSubsystem.h"
+#include "PortalCharacterMovementComponent.h"
+#include "TweenSubsystem.h"
+#include "PlayerAimComponent.h"
+#include "GrabableActor.h"
 #include "LaserCube.h"
+#include "GameFramework/PlayerState.h"
+#include "Net/UnrealNetwork.h"
 
 
-ATPSCharacter::ATPSCharacter()
+ATPSCharacter::ATPSCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UPortalCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(32.f, 88.0f);
@@ -69,6 +77,9 @@ ATPSCharacter::ATPSCharacter()
 
 	PhysicsHandle = CreateDefaultSubobject<UPhysicsHandleComponent>(TEXT("Handle"));
 
+	Aim = CreateDefaultSubobject<UPlayerAimComponent>(TEXT("Aim"));
+	Aim->SetAimCamera(FPSCamera);
+
 }
 
 void ATPSCharacter::BeginPlay()
@@ -76,33 +87,69 @@ void ATPSCharacter::BeginPlay()
 	Super::BeginPlay();
 
 	ActiveFPSCamera();
-	InitLerpSetting();
 }
 
 void ATPSCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
-	GetWorld()->GetTimerManager().ClearTimer(CameraFOVLerpTimerHandle);
-	GetWorld()->GetTimerManager().ClearTimer(GrabLocAndRotTimerHandle);
+	if (GrabedComponent.IsValid())
+		ReleaseGrab();
+
+	UTweenSubsystem* TweenSubsystem = GetWorld()->GetSubsystem<UTweenSubsystem>();
+	if (TweenSubsystem)
+		TweenSubsystem->StopAll(this);
 }
 
 void ATPSCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	if (IsGrab)
+	if (IsGrab == false) return;
+
+	if (GrabedComponent.IsValid() == false)
+	{
+		ReleaseGrab();
+		return;
+	}
+
+	// Remote clients only follow the server's carry target
+	if (GetLocalRole() == ROLE_SimulatedProxy)
+	{
+		SmoothedCarryLocation = FMath::VInterpTo(SmoothedCarryLocation, Carry.Location, DeltaTime, CarryInterpSpeed);
+		PhysicsHandle->SetTargetLocationAndRotation(SmoothedCarryLocation, FRotator(0.f, Carry.Yaw, 0.f));
+		return;
+	}
+
+	FVector GrabedActorLocation = GrabedComponent->GetComponentLocation();
+	FVector CharactrLocation = GetActorLocation();
+	float Dist = FVector::Dist(GrabedActorLocation, CharactrLocation);
+	if (Dist > 200)
 	{
-		FVector GrabedActorLocation = GrabedComponent->GetComponentLocation();
-		FVector CharactrLocation = GetActorLocation();
-		float Dist = FVector::Dist(GrabedActorLocation, CharactrLocation);
-		if (Dist > 200)
-			GrabActor();
+		// Owner and server both check, whoever notices first tells the other
+		UPrimitiveComponent* DroppedComponent = GrabedComponent.Get();
+		ReleaseGrab();
+		if (IsLocallyControlled() == false)
+			ClientReleaseGrab(DroppedComponent);
+		else if (HasAuthority() == false)
+			ServerReleaseGrab();
+		return;
+	}
 
+	GrabRotator = FRotator(0.f, GetActorRotation().Yaw, 0.f);
+	GrabLocation = GetCarryLocation(130.f);
+	PhysicsHandle->SetTargetLocationAndRotation(GrabLocation, GrabRotator);
 
-		GrabRotator = FRotator(0.f, GetActorRotation().Yaw, 0.f);
-		GrabLocation = FPSCamera->GetComponentLocation() + FPSCamera->GetForwardVector() * 130.f;
-		PhysicsHandle->SetTargetLocationAndRotation(GrabLocation, GrabRotator);
+	if (HasAuthority() == false) return;
+
+	// A fixed low rate whatever the character's own net update frequency
+	const float CarryNetInterval = 1.f / FMath::Max(CarryNetRate, 1.f);
+	CarryNetTime += DeltaTime;
+	if (CarryNetTime >= CarryNetInterval)
+	{
+		CarryNetTime = FMath::Fmod(CarryNetTime, CarryNetInterval);
+		Carry.Location = GrabLocation;
+		Carry.Yaw = GrabRotator.Yaw;
 	}
 }
 
@@ -138,190 +185,312 @@ void ATPSCharacter::SetupPlayerInputComponent(class UInputComponent* PlayerInput
 
 void ATPSCharacter::SpawnPortalA()
 {
-	auto World = GetWorld();
-	if (World == nullptr) return;
+	if (SpawnPortal(true) == false) return;
 
-	FHitResult HitResult;
-	FVector Start = FPSCamera->GetComponentLocation();
-	FVector End = Start + FPSCamera->GetForwardVector() * 10000.f;
-	FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, false, this);
+	if (SC_PortalA)
+		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_PortalA, GetActorLocation());
+}
 
-	bool Result = World->LineTraceSingleByChannel(HitResult,
-		Start,
-		End,
-		ECollisionChannel::ECC_GameTraceChannel1,
-		QueryParam);
+void ATPSCharacter::SpawnPortalB()
+{
+	if (SpawnPortal(false) == false) return;
 
-	if (Result && HitResult.IsValidBlockingHit() == false) return;
+	if (SC_PortalB)
+		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_PortalB, GetActorLocation());
+}
 
+static UClass* LoadPortalClass()
+{
+	FName Path = TEXT("Class'/Game/Portal/BP_Portal.BP_Portal_C'");
+	return Cast<UClass>(StaticLoadObject(UClass::StaticClass(), NULL, *Path.ToString()));
+}
+
+bool ATPSCharacter::SpawnPortal(bool bPortalA)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return false;
+
+	UPortalSubsystem* PortalSubsystem = World->GetSubsystem<UPortalSubsystem>();
+	if (PortalSubsystem == nullptr) return false;
+
+	// Pairs belong to the player state so every machine knows whose they are and they survive a respawn
+	APlayerState* PortalOwner = GetPlayerState();
+	if (PortalOwner == nullptr) return false;
+
+	// Portals can be shot through the other portal
+	const FAimHit& AimHit = Aim->GetAim(EAimChannel::Portal);
+	if (AimHit.TargetType != EAimTargetType::PORTAL_WALL) return false;
+
+	const FHitResult& HitResult = *AimHit.GetBlockingHit();
 	APortalWall* PortalWall = Cast<APortalWall>(HitResult.GetActor());
-	if (PortalWall == nullptr) return;
+	if (PortalWall == nullptr) return false;
 
-	std::pair<bool, FTransform> ClampResult = PortalWall->ClampPortalPosition(HitResult.Location, PortalB);
+	// The portal it replaces may overlap the new one, any other portal on the wall may not
+	std::pair<bool, FTransform> ClampResult = PortalWall->ClampPortalPosition(HitResult.Location, PortalSubsystem->GetPlayerPortal(PortalOwner, bPortalA));
 	bool CanSpawn = ClampResult.first;
 	FTransform ClampTransform = ClampResult.second;
 
-	if (CanSpawn == false) return;
+	if (CanSpawn == false) return false;
 
-	if (PortalA.IsValid()) PortalA->Destroy();
+	if (HasAuthority())
+		return PortalSubsystem->PlacePlayerPortal(PortalOwner, bPortalA, LoadPortalClass(), PortalWall, ClampTransform) != nullptr;
 
-	FName Path = TEXT("Class'/Game/Portal/BP_Portal.BP_Portal_C'");
-	UClass* BP_PortalClass = Cast<UClass>(StaticLoadObject(UClass::StaticClass(), NULL, *Path.ToString()));
+	// Shown right away, the server answers with its own portal or a rejection
+	const uint8 PredictionId = PortalSubsystem->PredictPlayerPortal(PortalOwner, bPortalA, LoadPortalClass(), PortalWall, ClampTransform);
+	if (PredictionId == 0) return false;
+
+	ServerSpawnPortal(bPortalA, PortalWall, ClampTransform.GetLocation(), PredictionId);
+	return true;
+}
 
-	APortal* Portal = World->SpawnActorDeferred<APortal>(BP_PortalClass, ClampTransform);
-	if (Portal)
+void ATPSCharacter::ServerSpawnPortal_Implementation(bool bPortalA, APortalWall* PortalWall, FVector_NetQuantize Location, uint8 PredictionId)
+{
+	UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>();
+	APlayerState* PortalOwner = GetPlayerState();
+	if (PortalSubsystem == nullptr || PortalWall == nullptr || PortalOwner == nullptr || IsPortalSpotInAim(PortalWall, Location) == false)
 	{
-		PortalA = Portal;
-		Portal->PortalA = true;
-		Portal->LinkPortal(PortalB);
-		Portal->FinishSpawning(ClampTransform);
+		ClientRejectPortal(bPortalA, PredictionId);
+		return;
 	}
 
-	if (SC_PortalA)
-		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_PortalA, GetActorLocation());
-
+	// Another player may have taken the spot while the request was on its way
+	std::pair<bool, FTransform> ClampResult = PortalWall->ClampPortalPosition(Location, PortalSubsystem->GetPlayerPortal(PortalOwner, bPortalA));
+	if (ClampResult.first == false || PortalSubsystem->PlacePlayerPortal(PortalOwner, bPortalA, LoadPortalClass(), PortalWall, ClampResult.second, PredictionId) == nullptr)
+		ClientRejectPortal(bPortalA, PredictionId);
 }
 
-void ATPSCharacter::SpawnPortalB()
+bool ATPSCharacter::IsPortalSpotInAim(APortalWall* PortalWall, const FVector& Location) const
 {
-	UWorld* World = GetWorld();
-	if (World == nullptr) return;
+	UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>();
+	if (PortalSubsystem == nullptr) return false;
 
-	FHitResult HitResult;
-	FVector Start = FPSCamera->GetComponentLocation();
-	FVector End = Start + FPSCamera->GetForwardVector() * 10000.f;
-	FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, false, this);
+	const FVector CameraLocation = FPSCamera->GetComponentLocation();
+	const FVector End = CameraLocation + GetBaseAimRotation().Vector() * (Aim->GetPortalRange() + PortalSpotTolerance);
 
-	bool Result = World->LineTraceSingleByChannel(HitResult,
-		Start,
-		End,
-		ECollisionChannel::ECC_GameTraceChannel1,
-		QueryParam);
+	FPortalTraceResult TraceResult;
+	if (PortalSubsystem->LineTraceThroughPortals(CameraLocation, End, ECollisionChannel::ECC_GameTraceChannel1, FCollisionQueryParams(SCENE_QUERY_STAT(ServerSpawnPortal), false, this), TraceResult) == false) return false;
 
-	if (Result && HitResult.IsValidBlockingHit() == false) return;
-
-	APortalWall* PortalWall = Cast<APortalWall>(HitResult.GetActor());
-	if (PortalWall == nullptr) return;
+	const FHitResult* HitResult = TraceResult.GetBlockingHit();
+	return HitResult->GetActor() == PortalWall && FVector::DistSquared(HitResult->Location, Location) <= FMath::Square(PortalSpotTolerance);
+}
 
-	std::pair<bool, FTransform> ClampResult = PortalWall->ClampPortalPosition(HitResult.Location, PortalA);
-	bool CanSpawn = ClampResult.first;
-	FTransform ClampTransform = ClampResult.second;
+void ATPSCharacter::ClientRejectPortal_Implementation(bool bPortalA, uint8 PredictionId)
+{
+	UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>();
+	if (PortalSubsystem && GetPlayerState())
+		PortalSubsystem->RejectPlayerPortal(GetPlayerState(), bPortalA, PredictionId);
+}
 
-	if (CanSpawn == false) return;
+void ATPSCharacter::OnPortalTransit()
+{
+	++PortalTransit.Count;
+	PortalTransit.Location = GetActorLocation();
+}
 
-	if (PortalB.IsValid()) PortalB->Destroy();
+void ATPSCharacter::OnRep_PortalTransit()
+{
+	// The owner is moved by its movement component's correction
+	if (GetLocalRole() != ROLE_SimulatedProxy) return;
 
-	FName Path = TEXT("Class'/Game/Portal/BP_Portal.BP_Portal_C'");
-	UClass* BP_PortalClass = Cast<UClass>(StaticLoadObject(UClass::StaticClass(), NULL, *Path.ToString()));
+	SetActorLocation(PortalTransit.Location, false, nullptr, ETeleportType::TeleportPhysics);
 
-	APortal* Portal = World->SpawnActorDeferred<APortal>(BP_PortalClass, ClampTransform);
-	if (Portal)
+	// Smoothing would slide the mesh all the way from the entry to the exit
+	if (FNetworkPredictionData_Client_Character* ClientData = GetCharacterMovement()->GetPredictionData_Client_Character())
 	{
-		PortalB = Portal;
-		Portal->PortalA = false;
-		Portal->LinkPortal(PortalA);
-		Portal->FinishSpawning(ClampTransform);
+		ClientData->MeshTranslationOffset = FVector::ZeroVector;
+		ClientData->OriginalMeshTranslationOffset = FVector::ZeroVector;
+		ClientData->MeshRotationOffset = ClientData->MeshRotationTarget;
+		ClientData->OriginalMeshRotationOffset = ClientData->MeshRotationTarget;
 	}
+	GetCharacterMovement()->bNetworkSmoothingComplete = false;
+}
 
-	if (SC_PortalB)
-		UGameplayStatics::PlaySoundAtLocation(GetWorld(), SC_PortalB, GetActorLocation());
+void ATPSCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(ATPSCharacter, PortalTransit, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(ATPSCharacter, Carry, COND_SkipOwner);
 }
 
 void ATPSCharacter::GrabActor()
 {
-	if (IsGrab == false)
+	if (GrabedComponent.IsValid() == false)
 	{
-		FHitResult HitResult;
-		FVector Start = FPSCamera->GetComponentLocation();
-		FVector End = Start + FPSCamera->GetForwardVector() * 200.f;
-		FCollisionQueryParams QueryParam = FCollisionQueryParams(NAME_None, false, this);
-		bool Result = GetWorld()->LineTraceSingleByChannel(HitResult, Start, End, ECollisionChannel::ECC_GameTraceChannel6, QueryParam);
-
-		if (Result == false) return;
-
-		ALaserCube* ReflectCube = Cast<ALaserCube>(HitResult.Actor);
-		if (ReflectCube)
-		{
-			FVector startLoc = ReflectCube->GetActorLocation();
-			FVector endLoc = FPSCamera->GetComponentLocation() + FPSCamera->GetForwardVector() * 180.f - FPSCamera->GetUpVector() * 10.f;
-			FRotator startRot = ReflectCube->GetActorRotation();
-			FRotator endRot = FRotator(0.f, GetActorRotation().Yaw, 0.f);
-			SetGrabLocAndRotTimer(HitResult, startLoc, endLoc, startRot, endRot);
-		}
-		else
-		{
-			AActor* HitActor = HitResult.GetActor();
-			FVector startLoc = HitActor->GetActorLocation();
-			FVector endLoc = FPSCamera->GetComponentLocation() + FPSCamera->GetForwardVector() * 180.f;
-			FRotator startRot = HitActor->GetActorRotation();
-			FRotator endRot = startRot;
-			SetGrabLocAndRotTimer(HitResult, startLoc, endLoc, startRot, endRot);
-		}
+		const FAimHit& AimHit = Aim->GetAim(EAimChannel::Grab);
+		if (AimHit.TargetType != EAimTargetType::GRABABLE && AimHit.TargetType != EAimTargetType::LASER_CUBE) return;
+
+		UPrimitiveComponent* Component = AimHit.GetBlockingHit()->GetComponent();
+		if (Component == nullptr || BeginGrab(Component) == false) return;
+
+		if (HasAuthority() == false)
+			ServerGrab(Component);
 	}
 	else
 	{
-		PhysicsHandle->ReleaseComponent();
-		GrabedComponent.Reset();
-		IsGrab = false;
+		ReleaseGrab();
+
+		if (HasAuthority() == false)
+			ServerReleaseGrab();
 	}
 }
 
-void ATPSCharacter::InitLerpSetting()
+bool ATPSCharacter::BeginGrab(UPrimitiveComponent* Component)
 {
-	LerpTime = 0.05f;
-	IntervalTime = LerpTime / 16;
-}
+	AGrabableActor* Grabable = Cast<AGrabableActor>(Component->GetOwner());
+	if (Grabable == nullptr) return false;
 
-void ATPSCharacter::SetCameraFOVTimer(float startFOV, float targetFOV)
-{
-	CameraFOVLerpTimerDelegate = FTimerDelegate::CreateUObject(this, &ATPSCharacter::LerpCameraFOV, startFOV, targetFOV);
-	GetWorld()->GetTimerManager().SetTimer(CameraFOVLerpTimerHandle, CameraFOVLerpTimerDelegate, IntervalTime, true);
+	if (HasAuthority())
+	{
+		// Another player got it first
+		if (Grabable->GetCarrier() && Grabable->GetCarrier() != this) return false;
+
+		Grabable->SetCarrier(this);
+	}
+
+	GrabedComponent = Component;
+
+	if (Grabable->IsA<ALaserCube>())
+	{
+		FVector endLoc = GetCarryLocation(180.f) - FRotationMatrix(GetBaseAimRotation()).GetUnitAxis(EAxis::Z) * 10.f;
+		FRotator endRot = FRotator(0.f, GetActorRotation().Yaw, 0.f);
+		PlayGrabTween(Component, endLoc, endRot);
+	}
+	else
+	{
+		FVector endLoc = GetCarryLocation(180.f);
+		FRotator endRot = Grabable->GetActorRotation();
+		PlayGrabTween(Component, endLoc, endRot);
+	}
+	return true;
 }
 
-void ATPSCharacter::LerpCameraFOV(float startFOV, float targetFOV)
+void ATPSCharacter::ReleaseGrab()
 {
-	FOVCurrentTime += IntervalTime;
-	float alpha = FOVCurrentTime / LerpTime;
-	FPSCamera->SetFieldOfView(FMath::Lerp(startFOV, targetFOV, alpha));
+	UTweenSubsystem* TweenSubsystem = GetWorld()->GetSubsystem<UTweenSubsystem>();
+	if (TweenSubsystem)
+		TweenSubsystem->Stop(GrabTween);
 
-	if (FOVCurrentTime >= LerpTime)
+	PhysicsHandle->ReleaseComponent();
+
+	if (HasAuthority())
 	{
-		FPSCamera->SetFieldOfView(targetFOV);
-		FOVCurrentTime = 0.f;
-		GetWorld()->GetTimerManager().ClearTimer(CameraFOVLerpTimerHandle);
+		AGrabableActor* Grabable = GrabedComponent.IsValid() ? Cast<AGrabableActor>(GrabedComponent->GetOwner()) : nullptr;
+		if (Grabable && Grabable->GetCarrier() == this)
+			Grabable->SetCarrier(nullptr);
+
+		Carry.Component = nullptr;
 	}
+
+	GrabedComponent.Reset();
+	IsGrab = false;
 }
 
-void ATPSCharacter::SetGrabLocAndRotTimer(FHitResult hitResult, FVector startLoc, FVector endLoc, FRotator startRot, FRotator endRot)
+void ATPSCharacter::ServerGrab_Implementation(UPrimitiveComponent* Component)
 {
-	GrabLocAndRotTimerDelegate = FTimerDelegate::CreateUObject(this, &ATPSCharacter::LerpGrabLocAndRot, hitResult, startLoc, endLoc, startRot, endRot);
-	GetWorld()->GetTimerManager().SetTimer(GrabLocAndRotTimerHandle, GrabLocAndRotTimerDelegate, IntervalTime, true);
+	if (Component == nullptr || GrabedComponent.IsValid() || IsInGrabRange(Component) == false || BeginGrab(Component) == false)
+		ClientReleaseGrab(Component);
 }
 
-void ATPSCharacter::LerpGrabLocAndRot(FHitResult hitResult, FVector startLoc, FVector endLoc, FRotator startRot, FRotator endRot)
+bool ATPSCharacter::IsInGrabRange(UPrimitiveComponent* Component) const
 {
-	GrabCurrentTime += IntervalTime;
-	float alpha = GrabCurrentTime / LerpTime;
-	hitResult.Actor->SetActorLocation(FMath::Lerp(startLoc, endLoc, alpha));
-	hitResult.Actor->SetActorRelativeRotation(FMath::Lerp(startRot, endRot, alpha));
+	const float MaxDistance = Aim->GetGrabRange() + GrabRangeTolerance;
+	const FVector CameraLocation = FPSCamera->GetComponentLocation();
 
-	if (GrabCurrentTime >= LerpTime)
+	FVector ClosestPoint;
+	const float Distance = Component->GetClosestPointOnCollision(CameraLocation, ClosestPoint);
+	if (Distance >= 0.f && Distance <= MaxDistance) return true;
+
+	// Grabbed through a portal, the body is far away in the world but right behind the other opening
+	UPortalSubsystem* PortalSubsystem = GetWorld()->GetSubsystem<UPortalSubsystem>();
+	if (PortalSubsystem == nullptr) return false;
+
+	FPortalTraceResult TraceResult;
+	const FVector End = CameraLocation + GetBaseAimRotation().Vector() * MaxDistance;
+	if (PortalSubsystem->LineTraceThroughPortals(CameraLocation, End, ECollisionChannel::ECC_GameTraceChannel6, FCollisionQueryParams(SCENE_QUERY_STAT(ServerGrab), false, this), TraceResult) == false) return false;
+
+	return TraceResult.GetPortalNum() > 0 && TraceResult.GetBlockingHit()->GetComponent() == Component;
+}
+
+void ATPSCharacter::ServerReleaseGrab_Implementation()
+{
+	if (GrabedComponent.IsValid())
+		ReleaseGrab();
+}
+
+void ATPSCharacter::ClientReleaseGrab_Implementation(UPrimitiveComponent* Component)
+{
+	// The answer may come after the owner already let go and grabbed something else
+	if (GrabedComponent.Get() == Component)
+		ReleaseGrab();
+}
+
+void ATPSCharacter::OnRep_Carry()
+{
+	if (GrabedComponent.Get() == Carry.Component) return;
+
+	if (GrabedComponent.IsValid())
+		ReleaseGrab();
+
+	if (Carry.Component == nullptr) return;
+
+	GrabedComponent = Carry.Component;
+	SmoothedCarryLocation = Carry.Component->GetComponentLocation();
+	PhysicsHandle->GrabComponentAtLocationWithRotation(Carry.Component, NAME_None, SmoothedCarryLocation, Carry.Component->GetComponentRotation());
+	IsGrab = true;
+}
+
+FVector ATPSCharacter::GetCarryLocation(float Distance) const
+{
+	return FPSCamera->GetComponentLocation() + GetBaseAimRotation().Vector() * Distance;
+}
+
+void ATPSCharacter::PlayGrabTween(UPrimitiveComponent* Component, FVector endLoc, FRotator endRot)
+{
+	UTweenSubsystem* TweenSubsystem = GetWorld()->GetSubsystem<UTweenSubsystem>();
+	if (TweenSubsystem == nullptr) return;
+
+	TweenSubsystem->Stop(GrabTween);
+
+	FTweenSettings Settings;
+	Settings.Duration = GrabLerpTime;
+	Settings.Ease = ETweenEase::EaseOut;
+
+	TWeakObjectPtr<AActor> GrabedActor = Component->GetOwner();
+	const FVector startLoc = GrabedActor->GetActorLocation();
+	const FRotator startRot = GrabedActor->GetActorRotation();
+
+	auto OnUpdate = [GrabedActor, startLoc, endLoc, startRot, endRot](float Alpha)
 	{
-		hitResult.Actor->SetActorLocation(endLoc);
-		hitResult.Actor->SetActorRelativeRotation(endRot);
-		GrabCurrentTime = 0.f;
-		GetWorld()->GetTimerManager().ClearTimer(GrabLocAndRotTimerHandle);
-		SetGrabSetting(hitResult);
-	}
+		if (GrabedActor.IsValid() == false) return;
+
+		GrabedActor->SetActorLocation(FMath::Lerp(startLoc, endLoc, Alpha));
+		GrabedActor->SetActorRelativeRotation(FMath::Lerp(startRot, endRot, Alpha));
+	};
+	TWeakObjectPtr<UPrimitiveComponent> WeakComponent = Component;
+	auto OnFinished = [this, WeakComponent]()
+	{
+		if (WeakComponent.IsValid() && GrabedComponent == WeakComponent)
+			SetGrabSetting(WeakComponent.Get());
+	};
+	GrabTween = TweenSubsystem->Play(this, Settings, OnUpdate, OnFinished);
 }
 
-void ATPSCharacter::SetGrabSetting(FHitResult hitResult)
+void ATPSCharacter::SetGrabSetting(UPrimitiveComponent* Component)
 {
-	GrabLocation = FPSCamera->GetComponentLocation() + FPSCamera->GetForwardVector() * 130.f;
+	GrabLocation = GetCarryLocation(130.f);
 	GrabRotator = FRotator(0.f, GetActorRotation().Yaw, 0.f);
-	GrabedComponent = hitResult.GetComponent();
-	PhysicsHandle->GrabComponentAtLocationWithRotation(GrabedComponent.Get(), NAME_None, GrabLocation, GrabRotator);
+	GrabedComponent = Component;
+	PhysicsHandle->GrabComponentAtLocationWithRotation(Component, NAME_None, GrabLocation, GrabRotator);
 	IsGrab = true;
+
+	if (HasAuthority())
+	{
+		Carry.Component = Component;
+		Carry.Location = GrabLocation;
+		Carry.Yaw = GrabRotator.Yaw;
+		CarryNetTime = 0.f;
+	}
 }
 
 void ATPSCharacter::ActiveFPSCamera()
@@ -6,6 +6,37 @@
 #include "GameFramework/Character.h"
 #include "TPSCharacter.generated.h"
 
+// Where the server last moved the character out of a portal
+USTRUCT()
+struct FPortalTransitNotify
+{
+	GENERATED_BODY()
+
+	// Bumped on every transit so the same exit twice still replicates
+	UPROPERTY()
+	uint8 Count = 0;
+
+	UPROPERTY()
+	FVector_NetQuantize Location;
+};
+
+// What a character carries, for the other clients
+USTRUCT()
+struct FGrabCarry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class UPrimitiveComponent* Component = nullptr;
+
+	// Where the carrier's physics handle pulls it, refreshed at CarryNetRate
+	UPROPERTY()
+	FVector_NetQuantize10 Location;
+
+	UPROPERTY()
+	float Yaw = 0.f;
+};
+
 UCLASS(config=Game)
 class ATPSCharacter : public ACharacter
 {
@@ -25,7 +56,7 @@ public:
 	class UCameraComponent* FPSCamera;
 
 public:
-	ATPSCharacter();
+	ATPSCharacter(const FObjectInitializer& ObjectInitializer);
 
 	virtual void BeginPlay() override;
 
@@ -33,6 +64,11 @@ public:
 
 	virtual void Tick(float DeltaTime) override;
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Server, the character just went through a portal
+	void OnPortalTransit();
+
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category=Camera)
 	float BaseTurnRate;
@@ -90,6 +126,28 @@ private:
 	UFUNCTION(BlueprintCallable, meta = (AllowPrivateAccess = "true"))
 	void SpawnPortalB();
 
+	bool SpawnPortal(bool bPortalA);
+
+	// Location is already clamped onto PortalWall by the client, the server checks it again
+	UFUNCTION(Server, Reliable)
+	void ServerSpawnPortal(bool bPortalA, class APortalWall* PortalWall, FVector_NetQuantize Location, uint8 PredictionId);
+
+	UFUNCTION(Client, Reliable)
+	void ClientRejectPortal(bool bPortalA, uint8 PredictionId);
+
+	// Server check of the owner's shot, the camera must aim at PortalWall near Location, also through a portal
+	bool IsPortalSpotInAim(class APortalWall* PortalWall, const FVector& Location) const;
+
+	// How far the aimed point may be from the requested spot, the client clamped it onto the wall and aimed a moment before
+	UPROPERTY(EditDefaultsOnly, Category = "Portal")
+	float PortalSpotTolerance = 200.f;
+
+	UPROPERTY(ReplicatedUsing = OnRep_PortalTransit)
+	FPortalTransitNotify PortalTransit;
+
+	UFUNCTION()
+	void OnRep_PortalTransit();
+
 
 	// Sound
 	UPROPERTY(EditDefaultsOnly)
@@ -98,6 +156,10 @@ private:
 	class USoundCue* SC_PortalB;
 
 
+	// Shared by portal shots, grabbing and the HUD crosshair
+	UPROPERTY(VisibleAnywhere)
+	class UPlayerAimComponent* Aim;
+
 	// GrabActor
 	UPROPERTY()
 	class UPhysicsHandleComponent* PhysicsHandle;
@@ -108,26 +170,54 @@ private:
 	FRotator GrabRotator;
 	FVector GrabLocation;
 
-	
+	// The owner grabs and releases right away, the server does the same and has the last word
+	bool BeginGrab(class UPrimitiveComponent* Component);
+	void ReleaseGrab();
+
+	UFUNCTION(Server, Reliable)
+	void ServerGrab(class UPrimitiveComponent* Component);
+
+	// Server check of the owner's grab, the component must be in reach of the camera or behind a portal it aims through
+	bool IsInGrabRange(class UPrimitiveComponent* Component) const;
+
+	// Reach the server adds to the grab range, the owner aimed a moment before the request arrived
+	UPROPERTY(EditDefaultsOnly, Category = "Grab")
+	float GrabRangeTolerance = 50.f;
+
+	UFUNCTION(Server, Reliable)
+	void ServerReleaseGrab();
+
+	// The server refused the grab or dropped the body
+	UFUNCTION(Client, Reliable)
+	void ClientReleaseGrab(class UPrimitiveComponent* Component);
 
-	// CameraFOVLerp
-	void InitLerpSetting();
-	FTimerHandle CameraFOVLerpTimerHandle;
-	FTimerDelegate CameraFOVLerpTimerDelegate;
-	void SetCameraFOVTimer(float startFOV, float targetFOV);
-	void LerpCameraFOV(float startFOV, float targetFOV);
-	float FOVCurrentTime;
-	// GrabLocationRotationLerp
-	FTimerHandle GrabLocAndRotTimerHandle;
-	FTimerDelegate GrabLocAndRotTimerDelegate;
-	void SetGrabLocAndRotTimer(FHitResult hitResult, FVector startLoc, FVector endLoc, FRotator startRot, FRotator endRot);
-	void LerpGrabLocAndRot(FHitResult hitResult, FVector startLoc, FVector endLoc, FRotator startRot, FRotator endRot);
-	float GrabCurrentTime;
+	// Where the camera looks on every machine, the FPS camera only turns on the owner
+	FVector GetCarryLocation(float Distance) const;
 
-	float IntervalTime;
-	float LerpTime;
+	UPROPERTY(ReplicatedUsing = OnRep_Carry)
+	FGrabCarry Carry;
 
-	void SetGrabSetting(FHitResult hitResult);
+	UFUNCTION()
+	void OnRep_Carry();
+
+	// Times per second the server refreshes Carry.Location
+	UPROPERTY(EditDefaultsOnly, Category = "Grab")
+	float CarryNetRate = 10.f;
+	float CarryNetTime = 0.f;
+
+	// How fast remote clients follow Carry.Location between updates
+	UPROPERTY(EditDefaultsOnly, Category = "Grab")
+	float CarryInterpSpeed = 15.f;
+	FVector SmoothedCarryLocation;
+
+
+	// GrabLocationRotationLerp, played by UTweenSubsystem
+	void PlayGrabTween(class UPrimitiveComponent* Component, FVector endLoc, FRotator endRot);
+	uint32 GrabTween = 0;
+	UPROPERTY(EditDefaultsOnly, Category = "Tween")
+	float GrabLerpTime = 0.05f;
+
+	void SetGrabSetting(class UPrimitiveComponent* Component);
 
 
 	// Camera
@@ -135,13 +225,6 @@ private:
 	void ActiveFPSCamera();
 	bool IsFPS;
 
-
-	UPROPERTY(VisibleInstanceOnly)
-	TWeakObjectPtr<class APortal> PortalA;
-
-	UPROPERTY(VisibleInstanceOnly)
-	TWeakObjectPtr<class APortal> PortalB;
-
 public:
 
 	float DirectionForward;
@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TweenSubsystem.h"
+#include "Curves/CurveFloat.h"
+
+DECLARE_CYCLE_STAT(TEXT("Tween Tick"), STAT_TweenTick, STATGROUP_Game);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tweens"), STAT_Tweens, STATGROUP_Game);
+
+void UTweenSubsystem::Deinitialize()
+{
+	Tweens.Empty();
+	PendingTweens.Empty();
+
+	Super::Deinitialize();
+}
+
+void UTweenSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TweenTick);
+	SET_DWORD_STAT(STAT_Tweens, Tweens.Num());
+
+	// Run after the loop so a callback starting or stopping tweens never sees the array half updated
+	TArray<TFunction<void()>, TInlineAllocator<8>> FinishedCallbacks;
+
+	bTicking = true;
+	for (FTween& Tween : Tweens)
+	{
+		if (Tween.bStopped) continue;
+
+		if (Tween.Owner.IsValid() == false)
+		{
+			Tween.bStopped = true;
+			continue;
+		}
+
+		const float Step = Tween.Duration > 0.f ? DeltaTime / Tween.Duration : 1.f;
+		Tween.Position += Tween.bReverse ? -Step : Step;
+
+		const bool bPassedEnd = Tween.Position >= 1.f || Tween.Position <= 0.f;
+		if (bPassedEnd && Tween.bPingPong)
+		{
+			// Fold the overshoot back so a long frame does not stretch the turn
+			Tween.Position = Tween.Position >= 1.f ? 2.f - Tween.Position : -Tween.Position;
+			Tween.bReverse = !Tween.bReverse;
+		}
+		Tween.Position = FMath::Clamp(Tween.Position, 0.f, 1.f);
+
+		Tween.OnUpdate(Evaluate(Tween));
+
+		if (bPassedEnd && Tween.bPingPong == false)
+		{
+			Tween.bStopped = true;
+			if (Tween.OnFinished)
+				FinishedCallbacks.Add(MoveTemp(Tween.OnFinished));
+		}
+	}
+	bTicking = false;
+
+	Tweens.RemoveAll([](const FTween& Tween) { return Tween.bStopped; });
+	Tweens.Append(MoveTemp(PendingTweens));
+	PendingTweens.Reset();
+
+	for (TFunction<void()>& OnFinished : FinishedCallbacks)
+		OnFinished();
+}
+
+bool UTweenSubsystem::IsTickable() const
+{
+	return Tweens.Num() > 0;
+}
+
+ETickableTickType UTweenSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UTweenSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UTweenSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTweenSubsystem, STATGROUP_Tickables);
+}
+
+uint32 UTweenSubsystem::Play(UObject* Owner, const FTweenSettings& Settings, TFunction<void(float)> OnUpdate, TFunction<void()> OnFinished)
+{
+	if (Owner == nullptr || OnUpdate == nullptr) return 0;
+
+	if (++LastId == 0)
+		++LastId;
+
+	float Duration = Settings.Duration;
+	if (Duration <= 0.f && Settings.Curve)
+	{
+		float MinTime, MaxTime;
+		Settings.Curve->GetTimeRange(MinTime, MaxTime);
+		Duration = MaxTime - MinTime;
+	}
+	if (Settings.PlayRate > 0.f)
+		Duration /= Settings.PlayRate;
+
+	FTween Tween;
+	Tween.Id = LastId;
+	Tween.Owner = Owner;
+	Tween.Curve = Settings.Curve;
+	Tween.Duration = Duration;
+	Tween.Position = Settings.bReverse ? 1.f : 0.f;
+	Tween.Ease = Settings.Ease;
+	Tween.bReverse = Settings.bReverse;
+	Tween.bPingPong = Settings.bPingPong;
+	Tween.bStopped = false;
+	Tween.OnUpdate = MoveTemp(OnUpdate);
+	Tween.OnFinished = MoveTemp(OnFinished);
+
+	if (bTicking)
+		PendingTweens.Add(MoveTemp(Tween));
+	else
+		Tweens.Add(MoveTemp(Tween));
+
+	return LastId;
+}
+
+bool UTweenSubsystem::SetReverse(uint32 Id, bool bReverse)
+{
+	FTween* Tween = FindTween(Id);
+	if (Tween == nullptr) return false;
+
+	Tween->bReverse = bReverse;
+	return true;
+}
+
+void UTweenSubsystem::Stop(uint32 Id, bool bComplete)
+{
+	FTween* Tween = FindTween(Id);
+	if (Tween == nullptr) return;
+
+	Tween->bStopped = true;
+
+	TFunction<void(float)> OnUpdate;
+	TFunction<void()> OnFinished;
+	float Alpha = 0.f;
+	if (bComplete)
+	{
+		Tween->Position = Tween->bReverse ? 0.f : 1.f;
+		Alpha = Evaluate(*Tween);
+		OnUpdate = MoveTemp(Tween->OnUpdate);
+		OnFinished = MoveTemp(Tween->OnFinished);
+	}
+
+	if (bTicking == false)
+		Tweens.RemoveAll([Id](const FTween& Other) { return Other.Id == Id; });
+
+	if (OnUpdate)
+		OnUpdate(Alpha);
+	if (OnFinished)
+		OnFinished();
+}
+
+void UTweenSubsystem::StopAll(const UObject* Owner)
+{
+	auto IsOwned = [Owner](const FTween& Tween) { return Tween.Owner.Get() == Owner; };
+
+	if (bTicking)
+	{
+		for (FTween& Tween : Tweens)
+		{
+			if (IsOwned(Tween))
+				Tween.bStopped = true;
+		}
+		PendingTweens.RemoveAll(IsOwned);
+	}
+	else
+	{
+		Tweens.RemoveAll(IsOwned);
+	}
+}
+
+bool UTweenSubsystem::IsPlaying(uint32 Id) const
+{
+	return FindTween(Id) != nullptr;
+}
+
+float UTweenSubsystem::ApplyEase(ETweenEase Ease, float Alpha)
+{
+	switch (Ease)
+	{
+	case ETweenEase::EaseIn:
+		return FMath::InterpEaseIn(0.f, 1.f, Alpha, 2.f);
+	case ETweenEase::EaseOut:
+		return FMath::InterpEaseOut(0.f, 1.f, Alpha, 2.f);
+	case ETweenEase::EaseInOut:
+		return FMath::InterpEaseInOut(0.f, 1.f, Alpha, 2.f);
+	default:
+		return Alpha;
+	}
+}
+
+UTweenSubsystem::FTween* UTweenSubsystem::FindTween(uint32 Id)
+{
+	return const_cast<FTween*>(static_cast<const UTweenSubsystem*>(this)->FindTween(Id));
+}
+
+const UTweenSubsystem::FTween* UTweenSubsystem::FindTween(uint32 Id) const
+{
+	if (Id == 0) return nullptr;
+
+	auto Matches = [Id](const FTween& Tween) { return Tween.Id == Id && Tween.bStopped == false; };
+
+	const FTween* Tween = Tweens.FindByPredicate(Matches);
+	return Tween ? Tween : PendingTweens.FindByPredicate(Matches);
+}
+
+float UTweenSubsystem::Evaluate(const FTween& Tween)
+{
+	if (const UCurveFloat* Curve = Tween.Curve.Get())
+	{
+		float MinTime, MaxTime;
+		Curve->GetTimeRange(MinTime, MaxTime);
+		return Curve->GetFloatValue(FMath::Lerp(MinTime, MaxTime, Tween.Position));
+	}
+
+	return ApplyEase(Tween.Ease, Tween.Position);
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "TweenSubsystem.generated.h"
+
+enum class ETweenEase : uint8
+{
+	Linear,
+	EaseIn,
+	EaseOut,
+	EaseInOut
+};
+
+struct FTweenSettings
+{
+	// Seconds from 0 to 1, the curve's own length when zero and Curve is set
+	float Duration = 0.f;
+
+	// Divides Duration, like a timeline's play rate
+	float PlayRate = 1.f;
+
+	ETweenEase Ease = ETweenEase::Linear;
+
+	// Replaces Ease when set, sampled over its whole time range
+	class UCurveFloat* Curve = nullptr;
+
+	// Runs from 1 to 0
+	bool bReverse = false;
+
+	// Turns around at either end instead of finishing
+	bool bPingPong = false;
+};
+
+/**
+ * Plays every short animation in the world: grab pull-in, switch presses
+ * and floating platforms. All tweens advance together in one
+ * tick by the world's delta time, so they take the same time at any frame
+ * rate, and the actors they animate need neither a timer nor a timeline
+ * component nor a tick of their own.
+ *
+ * A tween belongs to an owner and is dropped without callbacks once the
+ * owner is gone. OnUpdate gets the eased alpha every frame, OnFinished runs
+ * after the last update. Ids are never 0.
+ */
+UCLASS()
+class TPS_API UTweenSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	uint32 Play(UObject* Owner, const FTweenSettings& Settings, TFunction<void(float)> OnUpdate, TFunction<void()> OnFinished = nullptr);
+
+	// Turns a running tween around where it is, false when it already finished
+	bool SetReverse(uint32 Id, bool bReverse);
+
+	// With bComplete the tween jumps to its end and finishes right away
+	void Stop(uint32 Id, bool bComplete = false);
+	void StopAll(const UObject* Owner);
+
+	bool IsPlaying(uint32 Id) const;
+
+	int32 GetTweenNum() const { return Tweens.Num() + PendingTweens.Num(); }
+
+	static float ApplyEase(ETweenEase Ease, float Alpha);
+
+private:
+
+	struct FTween
+	{
+		uint32 Id;
+		TWeakObjectPtr<UObject> Owner;
+		TWeakObjectPtr<class UCurveFloat> Curve;
+		float Duration;
+
+		// Linear progress, 0 to 1
+		float Position;
+
+		ETweenEase Ease;
+		bool bReverse;
+		bool bPingPong;
+		bool bStopped;
+
+		TFunction<void(float)> OnUpdate;
+		TFunction<void()> OnFinished;
+	};
+
+	FTween* FindTween(uint32 Id);
+	const FTween* FindTween(uint32 Id) const;
+
+	static float Evaluate(const FTween& Tween);
+
+private:
+
+	TArray<FTween> Tweens;
+
+	// Started from a callback during Tick, joins Tweens after it
+	TArray<FTween> PendingTweens;
+
+	uint32 LastId = 0;
+	bool bTicking = false;
+};